@@ -6,13 +6,40 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <tuple>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
 
 #include "TString.h"
 #include "TTree.h"
 #include "TFile.h"
 #include "TObject.h"
+#include "TROOT.h"
+#include "RVersion.h"
+#include "ROOT/TBufferMerger.hxx"
+
+// TBufferMerger moved out of ROOT::Experimental in ROOT 6.26
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,26,0)
+/** ROOT object that merges the files written by several threads into one output file */
+typedef ROOT::TBufferMerger ArbolMerger;
+/** In-memory file that is handed to each thread by ArbolMerger */
+typedef ROOT::TBufferMergerFile ArbolMergerFile;
+#else
+typedef ROOT::Experimental::TBufferMerger ArbolMerger;
+typedef ROOT::Experimental::TBufferMergerFile ArbolMergerFile;
+#endif
 
 #include "hepcli.h"
+#include "columnwriter.h"
 #include "utilities.h"
 
 /**
@@ -25,6 +52,25 @@ class Branch : public Utilities::Variable<Type>
 private:
     /** Pointer to ROOT TBranch object */
     TBranch* branch;
+    /** Name of branch */
+    TString branch_name;
+    /** Address of the value that an object (e.g. std::vector) branch reads from (see Branch::setAddress) */
+    Type* object_address;
+    /**
+     * Point the TTree branch of a fundamental type at a different value
+     * @param ttree pointer to TTree
+     * @param new_address pointer to value
+     * @return none
+     */
+    void setAddress(TTree* ttree, Type* new_address, std::false_type);
+    /**
+     * Point the TTree branch of an object type at a different value; ROOT takes the address 
+     * of a pointer to the object, so the pointer is kept by this object
+     * @param ttree pointer to TTree
+     * @param new_address pointer to value
+     * @return none
+     */
+    void setAddress(TTree* ttree, Type* new_address, std::true_type);
 public:
     /**
      * Branch object default constructor
@@ -38,8 +84,235 @@ public:
      * @return none
      */
     Branch(TTree* ttree, TString new_branch_name);
+    /**
+     * Branch object constructor for a value held elsewhere (e.g. in a Utilities::ResetArena)
+     * @param ttree pointer to TTree
+     * @param new_branch_name new branch name
+     * @param new_value pointer to branch value
+     * @param new_reset_value pointer to branch reset value
+     * @return none
+     */
+    Branch(TTree* ttree, TString new_branch_name, Type* new_value, Type* new_reset_value);
+    /**
+     * Point the TTree branch at a different value (the value of this object is unchanged)
+     * @param ttree pointer to TTree
+     * @param new_address pointer to value that the TTree reads from when it is filled
+     * @return none
+     */
+    void setAddress(TTree* ttree, Type* new_address);
+};
+
+/**
+ * Fills a TTree on a background thread, such that basket compression and disk writes do 
+ * not happen on the event loop thread (see Arbol::setAsync).
+ *
+ * Each filled entry is copied into a free staging slot (an arena with the same layout as 
+ * the branch values), which is queued for the writer thread. The writer thread copies the 
+ * slot into its own copy of the branch values, which the TTree branches point to, then 
+ * calls TTree::Fill and frees the slot.
+ */
+class ArbolWriter
+{
+protected:
+    /** Pointer to ROOT TTree object that is filled by the writer thread */
+    TTree* ttree;
+    /** Branch values that the TTree branches point to */
+    Utilities::ResetArena tree_values;
+    /** Staging slots (a std::deque, so slots do not move when more are added) */
+    std::deque<Utilities::ResetArena> slots;
+    /** Slots that can be filled */
+    std::deque<Utilities::ResetArena*> free_slots;
+    /** Slots that are waiting to be written, in the order they were filled */
+    std::deque<Utilities::ResetArena*> filled_slots;
+    /** Wait for a free slot if all slots are in use (otherwise, add a new slot) */
+    bool block_when_full;
+    /** Flag indicating that the writer thread is writing a slot */
+    bool is_writing;
+    /** Flag indicating that the writer thread should stop once every slot is written */
+    bool is_stopping;
+    /** Exception raised on the writer thread (rethrown on the event loop thread) */
+    std::exception_ptr writer_error;
+    /** Mutex guarding the slot queues and flags */
+    std::mutex queue_mutex;
+    /** Signalled whenever a slot is freed */
+    std::condition_variable slot_freed;
+    /** Signalled whenever a slot is filled or the writer is stopped */
+    std::condition_variable slot_filled;
+    /** Writer thread */
+    std::thread writer;
+
+    /**
+     * (PROTECTED) Writer thread loop
+     * @return none
+     */
+    void run();
+
+    /**
+     * (PROTECTED) Rethrow any exception raised on the writer thread
+     * @return none
+     */
+    void checkWriter();
+public:
+    /**
+     * ArbolWriter object constructor; the TTree branches must be pointed at 
+     * ArbolWriter::getTreeValues before the first entry is pushed
+     * @param new_ttree pointer to TTree to fill
+     * @param values branch values (no values may be added afterwards)
+     * @param queue_size number of staging slots
+     * @param new_block_when_full wait for the writer if every slot is in use (otherwise, 
+     *                            add a new slot)
+     * @return none
+     */
+    ArbolWriter(TTree* new_ttree, Utilities::ResetArena& values, unsigned int queue_size, 
+                bool new_block_when_full);
+    /**
+     * ArbolWriter object destructor (writes any remaining entries)
+     * @return none
+     */
+    virtual ~ArbolWriter();
+    /**
+     * Get the branch values that the TTree branches should point to
+     * @return branch values
+     */
+    Utilities::ResetArena& getTreeValues();
+    /**
+     * Queue a copy of the current branch values to be filled (an exception is thrown if the 
+     * writer was already stopped)
+     * @param values branch values
+     * @return none
+     */
+    void push(Utilities::ResetArena& values);
+    /**
+     * Wait until every queued entry has been filled
+     * @return none
+     */
+    void drain();
+    /**
+     * Fill every queued entry, then stop the writer thread
+     * @return none
+     */
+    void stop();
+};
+
+/**
+ * Typed handle to the value of a branch, such that the leaf can be read or set without 
+ * looking up the branch by name
+ * @tparam Type type of branch value
+ */
+template<typename Type>
+class Leaf
+{
+protected:
+    /** Pointer to branch value */
+    Type* value;
+public:
+    /**
+     * Leaf object default constructor (not usable until assigned)
+     * @return none
+     */
+    Leaf();
+    /**
+     * Leaf object constructor
+     * @param new_value pointer to branch value
+     * @return none
+     */
+    Leaf(Type* new_value);
+    /**
+     * Get current leaf value
+     * @return leaf value
+     */
+    Type getValue();
+    /**
+     * Get reference to current leaf value
+     * @return reference to leaf value
+     */
+    Type& getReference();
+    /**
+     * Set current leaf value
+     * @param new_value new value
+     * @return none
+     */
+    void setValue(Type new_value);
+};
+
+/**
+ * Output settings of an Arbol, which trade CPU for disk (e.g. LZ4 for intermediate skims, 
+ * ZSTD or LZMA for archival); see Arbol::setOutputPolicy
+ */
+struct OutputPolicy
+{
+    /** ROOT compression settings, i.e. 100*algorithm + level (-1: keep current setting) */
+    int compression;
+    /** Basket size of every branch in bytes (0: keep current basket sizes) */
+    int basket_size;
+    /** TTree::SetAutoFlush threshold (> 0: entries, < 0: bytes, 0: keep current threshold) */
+    Long64_t auto_flush;
+    /** TTree::SetAutoSave threshold (> 0: entries, < 0: bytes, 0: keep current threshold) */
+    Long64_t auto_save;
+    /** Compression settings of individual branches (overrides OutputPolicy::compression) */
+    std::map<TString, int> branch_compressions;
+    /** Basket sizes of individual branches (overrides OutputPolicy::basket_size) */
+    std::map<TString, int> branch_basket_sizes;
+
+    /**
+     * OutputPolicy object constructor (keeps every ROOT default)
+     * @return none
+     */
+    OutputPolicy();
+    /**
+     * OutputPolicy object overload constructor
+     * @param cli HEPCLI object (--compression, --basket_size, --auto_flush, --auto_save)
+     * @return none
+     */
+    OutputPolicy(HEPCLI& cli);
+    /**
+     * Get ROOT compression settings for a given algorithm and level
+     * @param algorithm compression algorithm ('ZLIB', 'LZMA', 'LZ4', 'ZSTD', or 'NONE')
+     * @param level compression level from 1 to 9 (default: -1, the level ROOT recommends 
+     *              for the algorithm)
+     * @return compression settings
+     */
+    static int getCompression(std::string algorithm, int level = -1);
+    /**
+     * Get ROOT compression settings from a string
+     * @param setting compression as 'ALGORITHM[:LEVEL]' (e.g. 'LZ4', 'ZSTD:5')
+     * @return compression settings
+     */
+    static int parseCompression(std::string setting);
 };
 
+/**
+ * Field of an output record (see Arbol::newRecord): a branch name and the struct member 
+ * that holds its value
+ * @tparam Record type of output record
+ * @tparam Type type of branch value
+ */
+template<typename Record, typename Type>
+struct RecordField
+{
+    /** Branch name */
+    const char* name;
+    /** Pointer to struct member */
+    Type Record::* member;
+};
+
+/**
+ * Get the field of an output record
+ * @tparam Record type of output record
+ * @tparam Type type of branch value
+ * @param name branch name
+ * @param member pointer to struct member
+ * @return record field
+ */
+template<typename Record, typename Type>
+RecordField<Record, Type> makeRecordField(const char* name, Type Record::* member)
+{
+    return RecordField<Record, Type>{name, member};
+}
+
+/** Field of an output record whose branch is named after the struct member */
+#define ARBOL_FIELD(Record, member) makeRecordField(#member, &Record::member)
+
 /**
  * Wraps TTree object with functionality for making branches dynamically
  */
@@ -48,16 +321,129 @@ class Arbol
 protected:
     /** Map of dynamically typed TBranches */
     std::map<TString, Utilities::Dynamic*> branches;
-    /** Map of reset function for each dynamically typed TBranch */
-    std::map<TString, std::function<void()>> branch_resetters;
+    /** Storage for the value and reset value of every dynamically typed TBranch */
+    Utilities::ResetArena arena;
+    /** Functions that point each TBranch at the matching value in a copy of the arena */
+    std::vector<std::function<void(TTree*, Utilities::ResetArena&, Utilities::ResetArena&)>> branch_rebinders;
+    /** Background writer (only set in asynchronous mode) */
+    std::shared_ptr<ArbolWriter> async_writer;
+    /** In-memory file of this thread (only set when writing through an ArbolMerger) */
+    std::shared_ptr<ArbolMergerFile> merger_file;
+    /** Flag indicating that the output file (or in-memory file) and its TTree were closed by Arbol::write */
+    bool is_closed;
+    /** Flag indicating that the output file was opened by this Arbol (i.e. not passed by the user) */
+    bool owns_tfile;
+    /** Compression, basket, and flush settings of the output */
+    OutputPolicy output_policy;
+    /** Columnar output (only set if Arbol::setColumnOutput is called) */
+    std::shared_ptr<ColumnWriter> column_writer;
+    /** Compressed size in bytes after which a new output file is started (0: no limit) */
+    Long64_t rollover_bytes;
+    /** Number of entries after which a new output file is started (0: no limit) */
+    Long64_t rollover_entries;
+    /** Number of output files that have been closed by a rollover */
+    unsigned int n_rollovers;
+    /** Name of the first output file without '.root' */
+    std::string output_stem;
+    /** Manifest rows ('file,entries,bytes') of the output files closed by a rollover */
+    std::vector<std::string> manifest_rows;
+    /** Directory of friend tree files (only set in friend mode) */
+    std::string friend_dir;
+    /** Number of input files that a friend tree has been started for */
+    unsigned int n_friend_files;
+    /** Names of the friend tree files written so far */
+    std::vector<std::string> friend_file_names;
+    /** Number of entries in the current input TTree */
+    Long64_t n_input_entries;
+    /** Next entry of the current input TTree that the friend tree has no entry for */
+    Long64_t next_input_entry;
+    /** Value of the 'input_file' branch (index of input file) */
+    int* input_file;
+    /** Value of the 'input_entry' branch (entry in input TTree) */
+    Long64_t* input_entry;
+    /** Branch values that are set aside while skipped input entries are filled */
+    std::shared_ptr<Utilities::ResetArena> friend_stash;
+    /**
+     * (PROTECTED) Fill the friend tree with reset values up to a given input entry, such 
+     * that it stays aligned with the input TTree
+     * @param end_entry first input entry that is not filled
+     * @return none
+     */
+    void padFriend(Long64_t end_entry);
+    /**
+     * (PROTECTED) Throw an exception if the output file (or the in-memory file, when writing 
+     * through an ArbolMerger) was closed by Arbol::write, since its TTree no longer exists
+     * @param caller name of calling method (e.g. 'Arbol::fill')
+     * @return none
+     */
+    void checkClosed(std::string caller);
+    /**
+     * (PROTECTED) Start a new output file if the current one has reached the rollover limits
+     * @return none
+     */
+    void checkRollover();
+    /**
+     * (PROTECTED) Write the current TTree and continue in a new output file; the current 
+     * file is closed if this Arbol opened it, and otherwise left open for the user
+     * @return none
+     */
+    void rollover();
     /**
-     * (PROTECTED) Get pointer to branch object if it exists
+     * (PROTECTED) Point every TBranch of the current TTree at its value again (e.g. after a 
+     * TTree that it was cloned from is deleted, which resets the addresses of its clones)
+     * @return none
+     */
+    virtual void rebind();
+    /**
+     * (PROTECTED) Get the manifest row ('file,entries,bytes') of an output file
+     * @param file_name output file name
+     * @param n_entries number of entries in output file
+     * @param n_bytes size of output file in bytes (-1: read from disk, i.e. file is closed)
+     * @return manifest row
+     */
+    static std::string getManifestRow(std::string file_name, Long64_t n_entries, Long64_t n_bytes);
+    /**
+     * (PROTECTED) Write the manifest of every output file to {output_stem}_manifest.csv
+     * @return none
+     */
+    void writeManifest();
+    /**
+     * (PROTECTED) Apply the basket size and compression of the output policy to a branch
+     * @param tbranch pointer to ROOT TBranch object
+     * @return none
+     */
+    void applyOutputPolicy(TBranch* tbranch);
+    /**
+     * (PROTECTED) Get pointer to branch object if it exists and has the given type
      * @tparam Type type of branch value
      * @param branch_name branch name
      * @return pointer to branch object
      */
     template<typename Type>
     Branch<Type>* getBranch(TString branch_name);
+    /**
+     * (PROTECTED) Make the branch of a single field of an output record
+     * @tparam Record type of output record
+     * @tparam Type type of branch value
+     * @param record pointer to output record
+     * @param reset_record pointer to reset value of output record
+     * @param field record field
+     * @return none
+     */
+    template<typename Record, typename Type>
+    void newRecordBranch(Record* record, Record* reset_record, RecordField<Record, Type> field);
+    /**
+     * (PROTECTED) Make the branches of every field of an output record
+     * @tparam Record type of output record
+     * @tparam Fields std::tuple of record fields
+     * @param record pointer to output record
+     * @param reset_record pointer to reset value of output record
+     * @param fields record fields
+     * @return none
+     */
+    template<typename Record, typename Fields, size_t... Indices>
+    void newRecordBranches(Record* record, Record* reset_record, Fields fields, 
+                           std::index_sequence<Indices...>);
 public:
     /** Pointer to ROOT TTree object */
     TTree* ttree;
@@ -89,6 +475,22 @@ public:
      * @return none
      */
     Arbol(HEPCLI& cli);
+    /**
+     * Arbol object overload constructor for writing the same output file from several 
+     * threads (one Arbol per thread); each Arbol fills a TTree in its own in-memory file, 
+     * which the merger appends to the output file whenever Arbol::write is called, e.g.
+     *
+     *     auto merger = std::make_shared<ArbolMerger>("output.root");
+     *     // On each thread
+     *     Arbol arbol = Arbol(merger);
+     *     ...
+     *     arbol.write();
+     *
+     * @param merger ArbolMerger (ROOT::TBufferMerger) shared by every thread
+     * @param ttree_name name of output TTree (default: 'tree')
+     * @return none
+     */
+    Arbol(std::shared_ptr<ArbolMerger> merger, TString ttree_name = "tree");
     /**
      * Arbol object destructor
      * @return none
@@ -98,19 +500,51 @@ public:
      * Add a new branch to TTree
      * @tparam Type type of branch value
      * @param new_branch_name new branch name
-     * @return none
+     * @return handle to new branch value
      */
     template<typename Type>
-    void newBranch(TString new_branch_name);
+    Leaf<Type> newBranch(TString new_branch_name);
     /**
      * Add a new branch to TTree and set reset value
      * @tparam Type type of branch value
      * @param new_branch_name new branch name
      * @param new_reset_value new branch reset value
-     * @return none
+     * @return handle to new branch value
+     */
+    template<typename Type>
+    Leaf<Type> newBranch(TString new_branch_name, Type new_reset_value);
+    /**
+     * Make one branch per field of an output record, i.e. a struct with a static fields() 
+     * method that lists its members with ARBOL_FIELD; filling is plain member assignment, 
+     * and the reset value of each branch is the default member initializer of its field
+     * @code{.cpp}
+     * struct Event
+     * {
+     *     float leading_lep_pt = -999.;
+     *     std::vector<float> jet_pts;
+     *     static auto fields() 
+     *     { 
+     *         return std::make_tuple(ARBOL_FIELD(Event, leading_lep_pt), ARBOL_FIELD(Event, jet_pts)); 
+     *     }
+     * };
+     * Event& event = arbol.newRecord<Event>();
+     * event.leading_lep_pt = 25.;
+     * arbol.fill();
+     * arbol.resetBranches();
+     * @endcode
+     * @tparam Record type of output record (must be default constructible)
+     * @return reference to record (valid for as long as this Arbol)
+     */
+    template<typename Record>
+    Record& newRecord();
+    /**
+     * Get a typed handle to the value of an existing branch
+     * @tparam Type type of branch value
+     * @param branch_name branch name
+     * @return handle to branch value
      */
     template<typename Type>
-    void newBranch(TString new_branch_name, Type new_reset_value);
+    Leaf<Type> getLeafHandle(TString branch_name);
     /**
      * Set reset value for the branch
      * @tparam Type type of branch value
@@ -142,20 +576,29 @@ public:
      * @see Arbol::newBranch
      * @tparam Type type of vector branch value
      * @param new_branch_name branch name
-     * @return none
+     * @return handle to new branch value
      */
     template<typename Type>
-    void newVecBranch(TString new_branch_name);
+    Leaf<std::vector<Type>> newVecBranch(TString new_branch_name);
     /**
      * Calls Arbol::newBranch, but supplies std::vector<Type> for tparam
      * @see Arbol::newBranch
      * @tparam Type type of vector branch value
      * @param new_branch_name new branch name
      * @param new_reset_vector new branch reset value (vector)
-     * @return none
+     * @return handle to new branch value
      */
     template<typename Type>
-    void newVecBranch(TString new_branch_name, std::vector<Type> new_reset_vector);
+    Leaf<std::vector<Type>> newVecBranch(TString new_branch_name, std::vector<Type> new_reset_vector);
+    /**
+     * Calls Arbol::getLeafHandle, but supplies std::vector<Type> for tparam
+     * @see Arbol::getLeafHandle
+     * @tparam Type type of vector branch value
+     * @param branch_name branch name
+     * @return handle to branch value
+     */
+    template<typename Type>
+    Leaf<std::vector<Type>> getVecLeafHandle(TString branch_name);
     /**
      * Calls Arbol::setBranchResetValue, but supplies std::vector<Type> for tparam
      * @see Arbol::setBranchResetValue
@@ -175,6 +618,23 @@ public:
      */
     template<typename Type>
     std::vector<Type> getVecLeaf(TString branch_name);
+    /**
+     * Get reference to current leaf value, which can be modified in place
+     * @tparam Type type of branch value
+     * @param branch_name branch name
+     * @return reference to leaf value
+     */
+    template<typename Type>
+    Type& getLeafRef(TString branch_name);
+    /**
+     * Calls Arbol::getLeafRef, but supplies std::vector<Type> for tparam
+     * @see Arbol::getLeafRef
+     * @tparam Type type of branch value
+     * @param branch_name branch name
+     * @return reference to leaf vector
+     */
+    template<typename Type>
+    std::vector<Type>& getVecLeafRef(TString branch_name);
     /**
      * Calls Arbol::setLeaf, but supplies std::vector<Type> for tparam
      * @see Arbol::getLeaf
@@ -187,7 +647,7 @@ public:
     void setVecLeaf(TString branch_name, std::vector<Type> new_vector);
 
     /**
-     * Append given value to leaf (vector)
+     * Append given value to leaf (vector) in place
      * @tparam Type type of branch value
      * @param branch_name branch name
      * @param new_value new value to append
@@ -205,7 +665,7 @@ public:
     template<typename Type>
     void prependToVecLeaf(TString branch_name, Type new_value);
     /**
-     * Insert value into leaf (vector) at a particular index
+     * Insert value into leaf (vector) at a particular index in place
      * @tparam Type type of branch value
      * @param branch_name branch name
      * @param new_value new value to insert
@@ -215,7 +675,7 @@ public:
     template<typename Type>
     void insertIntoVecLeaf(TString branch_name, Type new_value, int index);
     /**
-     * Sort leaf (vector) using a given lambda function
+     * Sort leaf (vector) in place using a given lambda function
      * @tparam Type type of branch value
      * @param branch_name branch name
      * @param lambda lambda function to use for sorting
@@ -224,22 +684,95 @@ public:
     template<typename Type>
     void sortVecLeaf(TString branch_name, std::function<bool(Type, Type)> &lambda);
     /**
-     * Set value of each branch to its respective reset value
-     * Uses a map of "resetters" for the same reason as Utilities::Variables.
+     * Set value of each branch to its respective reset value; scalar branches are reset 
+     * with a single memcpy, and vector branches keep their capacity, so refilling them does 
+     * not allocate
+     * Uses a Utilities::ResetArena for the same reason as Utilities::Variables.
      * @return none
      */
     void resetBranches();
     /**
-     * Fill TTree with all current leaves
+     * Fill TTree with all current leaves; in asynchronous mode, the leaves are copied and 
+     * queued instead
      * @return none
      */
     virtual void fill();
     /**
-     * Write TTree to TFile
+     * Write TTree to TFile (in asynchronous mode, every queued entry is filled first, and the 
+     * background thread is only stopped if the file is closed); when 
+     * writing through an ArbolMerger, the entries filled so far are handed to the merger 
+     * instead. Write may be called again to write (or hand over) more entries until the file 
+     * is closed, after which the Arbol can no longer be filled or written
      * @param close toggles whether TFile::Close is called after writing (default: true)
      * @return none
      */
     virtual void write(bool close = true);
+    /**
+     * Fill the TTree on a background thread from now on, so that basket compression and 
+     * disk writes do not stall the event loop; must be called after every branch is made
+     * (alternatively, ROOT::EnableImplicitMT compresses baskets on a thread pool)
+     * @param queue_size number of entries that can be queued (default: 64)
+     * @param block_when_full wait for the writer if the queue is full (default: true); 
+     *                        otherwise the queue grows, trading memory for never waiting
+     * @return none
+     */
+    void setAsync(unsigned int queue_size = 64, bool block_when_full = true);
+    /**
+     * Set the compression, basket sizes, and flush thresholds of the output; applies to 
+     * existing branches and to every branch made afterwards
+     * @param new_output_policy new output policy
+     * @return none
+     */
+    void setOutputPolicy(OutputPolicy new_output_policy);
+    /**
+     * Also write every branch as a flat, memory-mappable column file (see ColumnWriter), 
+     * e.g. for ML training; must be called before any branch is made, and only supports 
+     * arithmetic types and std::vectors of them. If this Arbol was made without a TFile 
+     * (i.e. Arbol::Arbol()), only the column files are written.
+     * @param output_dir target directory for column files and schema.json (must exist)
+     * @return none
+     */
+    void setColumnOutput(std::string output_dir);
+    /**
+     * Start a new output file, i.e. {name}_1.root, {name}_2.root, and so on after the first 
+     * file {name}.root, whenever the current one reaches a given size or number of entries; 
+     * each file is written and closed when the next one is started, and Arbol::write also 
+     * writes {name}_manifest.csv with the entries and size of every file. Cannot be used 
+     * with asynchronous filling or an ArbolMerger.
+     * @param max_bytes compressed size in bytes, e.g. 2e9 (0: no limit)
+     * @param max_entries number of entries (default: 0, no limit)
+     * @return none
+     */
+    void setRollover(Long64_t max_bytes, Long64_t max_entries = 0);
+    /**
+     * Write only the branches of this Arbol as friend trees of the input, i.e. one file per 
+     * input file (see Utilities::getFriendFileName) with exactly one entry per input entry, 
+     * which can be read alongside the input with Looper::addFriend. Entries that are not 
+     * filled get the reset value of every branch, and the 'input_file' and 'input_entry' 
+     * branches record the index of the input file and the entry in its TTree. Must be 
+     * called on an Arbol made with Arbol::Arbol() before any branch is made, and cannot be 
+     * used with asynchronous filling or output file rollover. Since friend tree files are 
+     * named after the input file name alone, input files in different directories must not 
+     * share a name.
+     * @param output_dir directory of friend tree files (must exist)
+     * @param ttree_name name of friend TTree (default: 'Friends')
+     * @return none
+     */
+    void setFriendOutput(std::string output_dir, TString ttree_name = "Friends");
+    /**
+     * Write the friend tree of the previous input file and start the friend tree of the next 
+     * (an exception is thrown if the next input file has the same name as an earlier one)
+     * @param input_ttree pointer to TTree of the next input file
+     * @return none
+     */
+    void initFriend(TTree* input_ttree);
+    /**
+     * Fill the friend tree with all current leaves for a given input entry (and with reset 
+     * values for any input entries that were skipped)
+     * @param entry entry in input TTree (must increase from one call to the next)
+     * @return none
+     */
+    void fillFriend(Long64_t entry);
 };
 
 #include "arbol.icc"
@@ -16,6 +16,33 @@ protected:
     std::vector<TString> keep_branch_names;
     /** Pointer to current TTree to skim */
     TTree* orig_ttree;
+    /** Flag indicating that passing entries are collected and copied once per file */
+    bool bulk_mode;
+    /** Passing entries of the current TTree that have not been copied yet (bulk mode) */
+    std::vector<Long64_t> bulk_entries;
+    /** Branches of the current TTree that are copied to the output TTree */
+    std::vector<TBranch*> kept_branches;
+    /** Addresses of the kept branches when the output TTree was pointed at them */
+    std::vector<char*> kept_addresses;
+    /**
+     * (PROTECTED) Read the kept branches of the current TTree for a given entry, skipping 
+     * any branch that the user's reader has already read for that entry
+     * @param entry current entry
+     * @return none
+     */
+    void readEntry(int entry);
+    /**
+     * (PROTECTED) Copy the passing entries of the current TTree; if every entry passed, the 
+     * compressed baskets are copied as they are (fast cloning)
+     * @return none
+     */
+    void copyBulkEntries();
+    /**
+     * (PROTECTED) Point every TBranch of the current TTree at its value again, including the 
+     * branches copied from the current TTree to skim
+     * @return none
+     */
+    void rebind();
 public:
     /**
      * Arbusto object constructor
@@ -37,6 +64,16 @@ public:
      * @return none
      */
     Arbusto(HEPCLI& cli, std::vector<TString> branch_names);
+    /**
+     * Arbusto object overload constructor for skimming into the same output file from 
+     * several threads (one Arbusto and TChain per thread)
+     * @see Arbol::Arbol(std::shared_ptr<ArbolMerger>, TString)
+     * @param merger ArbolMerger (ROOT::TBufferMerger) shared by every thread
+     * @param tchain pointer to TChain of input TFiles
+     * @param branch_names std::vector of branch names to keep
+     * @return none
+     */
+    Arbusto(std::shared_ptr<ArbolMerger> merger, TChain* tchain, std::vector<TString> branch_names);
     /**
      * Arbusto object destructor
      * @return none
@@ -49,11 +86,59 @@ public:
      */
     void init(TTree* next_ttree);
     /**
-     * Fill TTree with all current leaves
+     * Enable the branches to keep in an original TTree (other branches are left as they are)
+     * @param next_ttree pointer to the next of the original TTree objects
+     * @return none
+     */
+    void enableBranches(TTree* next_ttree);
+    /**
+     * Point the output TTree at an original TTree whose branches are already enabled
+     * @param next_ttree pointer to the next of the original TTree objects
+     * @return none
+     */
+    void attach(TTree* next_ttree);
+    /**
+     * Fill TTree with all current leaves (in bulk mode, the entry is only recorded); kept 
+     * branches are only read if the user's reader has not already read them for this entry, 
+     * and the output TTree follows any addresses the reader sets on them
      * @param entry current entry
      * @return none
      */
     void fill(int entry);
+    /**
+     * Collect the passing entries of each file and copy them in one pass when the file is 
+     * finished (see Arbusto::finish), such that files where every entry passes are 
+     * fast-cloned without decompressing them; cannot be used with Arbol::newBranch or 
+     * Arbol::newRecord, and fast-cloned files keep the compression of the input. Only whole 
+     * files are fast-cloned (TTree::CopyEntries cannot fast-clone a range of entries, e.g. a 
+     * cluster), so a file where even one entry fails is copied entry by entry, in order
+     * @code{.cpp}
+     * arbusto.setBulkMode();
+     * looper.run(
+     *     [&](TTree* ttree) { arbusto.init(ttree); },
+     *     [&](int entry) { if (cutflow.run()) { arbusto.fill(entry); } },
+     *     [&](TTree* ttree) { arbusto.finish(); }
+     * );
+     * @endcode
+     * @param new_bulk_mode toggles bulk mode (default: true)
+     * @return none
+     */
+    void setBulkMode(bool new_bulk_mode = true);
+    /**
+     * Finish the current file, i.e. copy the passing entries collected in bulk mode; must be 
+     * called after the last entry of each file while the file is still open (e.g. in the 
+     * end-of-file lambda of Looper::run)
+     * @return none
+     */
+    void finish();
+    /**
+     * Write TTree to TFile (in bulk mode, Arbusto::finish must have been called for the 
+     * last file)
+     * @see Arbol::write
+     * @param close toggles whether TFile::Close is called after writing (default: true)
+     * @return none
+     */
+    void write(bool close = true);
 };
 
 #include "arbusto.icc"
@@ -0,0 +1,92 @@
+#ifndef BOSQUE_H
+#define BOSQUE_H
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include "TTree.h"
+
+#include "arbusto.h"
+
+/**
+ * Group of Arbusto skims that are filled from a single pass over the input, e.g. one skim 
+ * per Cutflow checkpoint; the union of the branches kept by every skim is enabled, and 
+ * each skim only reads the kept branches that have not been read for the current entry 
+ * yet (by the user's reader or another skim, per TBranch::GetReadEntry), so each branch 
+ * is read at most once per entry however many skims it passes
+ * @code{.cpp}
+ * Arbusto skim_a = Arbusto(tfile_a, tchain, {"run", "event", "Jet_pt"});
+ * Arbusto skim_b = Arbusto(tfile_b, tchain, {"run", "event", "Muon_pt"});
+ * Bosque bosque = Bosque();
+ * bosque.add(&skim_a);
+ * bosque.add(&skim_b);
+ * looper.run(
+ *     [&](TTree* ttree) { bosque.init(ttree); },
+ *     [&](int entry) 
+ *     {
+ *         // -> read whatever the cutflow needs here <--
+ *         bosque.fill(entry, cutflow.run(std::vector<std::string>({"SelectionA", "SelectionB"})));
+ *     },
+ *     [&](TTree* ttree) { bosque.finish(); }
+ * );
+ * bosque.write();
+ * @endcode
+ */
+class Bosque
+{
+protected:
+    /** Skims in the order they were added (not owned) */
+    std::vector<Arbusto*> arbustos;
+public:
+    /**
+     * Bosque object constructor
+     * @return none
+     */
+    Bosque();
+    /**
+     * Bosque object destructor
+     * @return none
+     */
+    virtual ~Bosque();
+    /**
+     * Add a skim; must be called before Bosque::init
+     * @param arbusto pointer to Arbusto (not owned)
+     * @return none
+     */
+    void add(Arbusto* arbusto);
+    /**
+     * Initialize every skim for current file
+     * @param next_ttree pointer to the next of the original TTree objects
+     * @return none
+     */
+    void init(TTree* next_ttree);
+    /**
+     * Fill every skim that the current entry passes
+     * @param entry current entry
+     * @param passed whether the entry passes each skim (in the order they were added)
+     * @return none
+     */
+    void fill(int entry, std::vector<bool> passed);
+    /**
+     * Fill every skim
+     * @param entry current entry
+     * @return none
+     */
+    void fill(int entry);
+    /**
+     * Finish the current file for every skim (see Arbusto::finish)
+     * @return none
+     */
+    void finish();
+    /**
+     * Write every skim
+     * @param close toggles whether TFile::Close is called after writing (default: true)
+     * @return none
+     */
+    void write(bool close = true);
+};
+
+#include "bosque.icc"
+
+#endif
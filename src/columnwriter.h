@@ -0,0 +1,207 @@
+#ifndef COLUMNWRITER_H
+#define COLUMNWRITER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <stdexcept>
+#include <stdint.h>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Describes how a branch type is laid out in a column file
+ * @tparam Type type of branch value
+ */
+template<typename Type>
+struct ColumnTraits
+{
+    /** Flag indicating that the type can be written as a column (any arithmetic type) */
+    static const bool is_column = std::is_arithmetic<Type>::value;
+    /** Flag indicating that each entry has a variable number of values */
+    static const bool is_vector = false;
+    /** Layout of the column (0: not a column, 1: scalar, 2: vector) */
+    static const int kind = (is_column) ? 1 : 0;
+    /** Type of the values in the column file */
+    typedef Type value_type;
+};
+
+/**
+ * Describes how a vector branch type is laid out in a column file
+ * @tparam Type type of vector branch value
+ */
+template<typename Type>
+struct ColumnTraits<std::vector<Type>>
+{
+    /** Flag indicating that the type can be written as a column (std::vector<bool> is not contiguous) */
+    static const bool is_column = std::is_arithmetic<Type>::value && !std::is_same<Type, bool>::value;
+    /** Flag indicating that each entry has a variable number of values */
+    static const bool is_vector = true;
+    /** Layout of the column (0: not a column, 1: scalar, 2: vector) */
+    static const int kind = (is_column) ? 2 : 0;
+    /** Type of the values in the column file */
+    typedef Type value_type;
+};
+
+/**
+ * Single column of a ColumnWriter: a data file with the values of every entry back to back 
+ * and, for vector branches, an offsets file with n_entries + 1 uint64 values such that the 
+ * values of entry i are data[offsets[i]:offsets[i + 1]]
+ */
+struct Column
+{
+    /** Column name */
+    std::string name;
+    /** Type of the values (e.g. 'float32', 'int64', 'bool') */
+    std::string dtype;
+    /** Flag indicating that the column has an offsets file */
+    bool has_offsets;
+    /** Number of values written so far */
+    uint64_t n_values;
+    /** Data file */
+    std::ofstream data_file;
+    /** Offsets file */
+    std::ofstream offsets_file;
+    /** Data that has not been written yet */
+    std::vector<char> data_buffer;
+    /** Offsets that have not been written yet */
+    std::vector<uint64_t> offsets_buffer;
+};
+
+/**
+ * Writes branches as flat, contiguous column files that can be memory-mapped without any 
+ * parsing (e.g. numpy.memmap), plus a schema.json file that describes every column:
+ *
+ *     {"n_entries": N, "byte_order": "little", "columns": [
+ *         {"name": "pt", "dtype": "float32", "data": "pt.col", "offsets": "pt.offsets"}, ...
+ *     ]}
+ *
+ * Values are written in the byte order of the host ("little" or "big"). Scalar columns have 
+ * no offsets file ("offsets": null). See Arbol::setColumnOutput.
+ */
+class ColumnWriter
+{
+protected:
+    /** Target directory for column files */
+    std::string output_dir;
+    /** Columns in the order they were added */
+    std::vector<std::shared_ptr<Column>> columns;
+    /** Functions that append the current value of each branch to its column */
+    std::vector<std::function<void()>> appenders;
+    /** Number of entries filled so far */
+    uint64_t n_entries;
+    /** Flag indicating that the column files were closed by ColumnWriter::write */
+    bool is_closed;
+    /** Number of bytes a column buffers before writing to disk */
+    static const unsigned int buffer_size = 1 << 20;
+
+    /**
+     * (PROTECTED) Open the files of a new column
+     * @param name column name
+     * @param dtype type of the values
+     * @param has_offsets toggles the offsets file
+     * @return pointer to new column
+     */
+    std::shared_ptr<Column> newColumn(std::string name, std::string dtype, bool has_offsets);
+    /**
+     * (PROTECTED) Append values to a column
+     * @param column column
+     * @param data pointer to the first value
+     * @param n_bytes number of bytes to append
+     * @return none
+     */
+    static void append(Column& column, const char* data, size_t n_bytes);
+    /**
+     * (PROTECTED) Write the buffered data and offsets of a column to disk (an exception is 
+     * thrown if either file could not be written)
+     * @param column column
+     * @return none
+     */
+    static void flush(Column& column);
+    /** Tag for branch types that cannot be written as a column */
+    typedef std::integral_constant<int, 0> NoColumn;
+    /** Tag for scalar branch types */
+    typedef std::integral_constant<int, 1> ScalarColumn;
+    /** Tag for vector branch types */
+    typedef std::integral_constant<int, 2> VectorColumn;
+    /**
+     * (PROTECTED) Placeholder for branch types that cannot be written as a column
+     * @tparam Type type of branch value
+     * @return empty function
+     */
+    template<typename Type>
+    std::function<void()> makeAppender(std::shared_ptr<Column> column, Type* value, NoColumn);
+    /**
+     * (PROTECTED) Get function that appends a scalar branch value
+     * @tparam Type type of branch value
+     * @param column column
+     * @param value pointer to branch value
+     * @return appender function
+     */
+    template<typename Type>
+    std::function<void()> makeAppender(std::shared_ptr<Column> column, Type* value, ScalarColumn);
+    /**
+     * (PROTECTED) Get function that appends the values of a vector branch and its next offset
+     * @tparam Type type of vector branch value
+     * @param column column
+     * @param value pointer to branch value
+     * @return appender function
+     */
+    template<typename Type>
+    std::function<void()> makeAppender(std::shared_ptr<Column> column, std::vector<Type>* value, 
+                                       VectorColumn);
+public:
+    /**
+     * ColumnWriter object constructor
+     * @param new_output_dir target directory for column files (must exist)
+     * @return none
+     */
+    ColumnWriter(std::string new_output_dir);
+    /**
+     * ColumnWriter object destructor
+     * @return none
+     */
+    virtual ~ColumnWriter();
+    /**
+     * Get the type of the values in the column file of a given branch type
+     * @tparam Type type of branch value
+     * @return type name (e.g. 'float32', 'uint8', 'bool')
+     */
+    template<typename Type>
+    static std::string getDType();
+    /**
+     * Get the byte order of the host, i.e. of the values in every column file
+     * @return 'little' or 'big'
+     */
+    static std::string getByteOrder();
+    /**
+     * Add a column that is filled from a branch value
+     * @tparam Type type of branch value (an arithmetic type or a std::vector of one)
+     * @param name column name
+     * @param value pointer to branch value (read whenever ColumnWriter::fill is called)
+     * @return none
+     */
+    template<typename Type>
+    void addColumn(std::string name, Type* value);
+    /**
+     * Append the current value of every branch to its column (cannot be called once the 
+     * column files are closed)
+     * @return none
+     */
+    void fill();
+    /**
+     * Write any buffered values and the schema file (describing every entry so far), then 
+     * close every column file if requested; may be called again to write more entries until 
+     * the column files are closed
+     * @param close toggles whether the column files are closed (default: true)
+     * @return none
+     */
+    void write(bool close = true);
+};
+
+#include "columnwriter.icc"
+
+#endif
@@ -1,5 +1,10 @@
 #include "cutflow.h"
 
+#ifdef RAPIDO_TRACE
+thread_local Utilities::RingBuffer<CutRecord, RAPIDO_TRACE_SIZE> Cutflow::trace;
+thread_local unsigned long Cutflow::n_traced_events = 0;
+#endif
+
 Cut::Cut(std::string new_name)
 {
     name = new_name;
@@ -11,6 +16,7 @@ Cut::Cut(std::string new_name)
     n_pass_weighted = 0.;
     n_fail_weighted = 0.;
     runtimes = Utilities::RunningStat();
+    id = -1;
 }
 
 Cut::~Cut() {}
@@ -113,11 +119,31 @@ double LambdaCut::weight()
     return weight_lambda();
 }
 
+CutRecord::CutRecord()
+{
+    event = 0;
+    cut_name[0] = '\0';
+    stage = Enter;
+    weight = 0.;
+}
+
+CutRecord::CutRecord(unsigned long new_event, Cut* cut, Stage new_stage, double new_weight)
+{
+    event = new_event;
+    std::strncpy(cut_name, cut->name.c_str(), sizeof(cut_name) - 1);
+    cut_name[sizeof(cut_name) - 1] = '\0';
+    stage = new_stage;
+    weight = new_weight;
+}
+
 Cutflow::Cutflow()
 {
     name = "cutflow";
     globals = Utilities::Variables();
     root = nullptr;
+    n_cuts_added = 0;
+    n_multi_weights = 0;
+    snapshots_enabled = false;
     debugger_is_set = false;
 }
 
@@ -126,6 +152,9 @@ Cutflow::Cutflow(std::string new_name)
     name = new_name;
     globals = Utilities::Variables();
     root = nullptr;
+    n_cuts_added = 0;
+    n_multi_weights = 0;
+    snapshots_enabled = false;
     debugger_is_set = false;
 }
 
@@ -133,11 +162,19 @@ Cutflow::Cutflow(std::string new_name, Cut* new_root)
 {
     name = new_name;
     globals = Utilities::Variables();
+    root = nullptr;
+    n_cuts_added = 0;
+    n_multi_weights = 0;
+    snapshots_enabled = false;
     setRoot(new_root);
     debugger_is_set = false;
 }
 
-Cutflow::~Cutflow() { recursiveDelete(root); }
+Cutflow::~Cutflow() 
+{ 
+    waitForSnapshot();
+    recursiveDelete(root); 
+}
 
 void Cutflow::setRoot(Cut* new_root)
 {
@@ -147,7 +184,7 @@ void Cutflow::setRoot(Cut* new_root)
     }
     else
     {
-        cut_record[new_root->name] = new_root;
+        recordCut(new_root);
     }
     root = new_root;
     return;
@@ -192,7 +229,7 @@ void Cutflow::insert(Cut* target_cut, Cut* new_cut, Direction direction)
             }
             target_cut->left = new_cut;
         }
-        cut_record[new_cut->name] = new_cut;
+        recordCut(new_cut);
     }
     return;
 }
@@ -235,7 +272,7 @@ void Cutflow::replace(Cut* target_cut, Cut* new_cut)
             target_cut->left->parent = new_cut;
         }
         cut_record.erase(target_cut->name);
-        cut_record[new_cut->name] = new_cut;
+        recordCut(new_cut);
     }
     return;
 }
@@ -296,7 +333,33 @@ bool Cutflow::run()
         std::string msg = "Error - no root node set.";
         throw std::runtime_error("Cutflow::run: "+msg);
     }
-    return recursiveEvaluate(root);
+    if (n_multi_weights > 0)
+    {
+        multi_weights = multi_weights_lambda();
+        if (multi_weights.size() != n_multi_weights)
+        {
+            std::string msg = "Error - expected "+std::to_string(n_multi_weights)+" alternative weights, "
+                              +"got "+std::to_string(multi_weights.size())+".";
+            throw std::runtime_error("Cutflow::run: "+msg);
+        }
+    }
+    bool passed;
+#ifdef RAPIDO_TRACE
+    n_traced_events++;
+    try
+    {
+        passed = recursiveEvaluate(root);
+    }
+    catch(...)
+    {
+        dumpTrace();
+        throw;
+    }
+#else
+    passed = recursiveEvaluate(root);
+#endif
+    if (snapshots_enabled) { checkSnapshot(); }
+    return passed;
 }
 
 bool Cutflow::run(Cut* target_cut)
@@ -390,47 +453,332 @@ void Cutflow::print(bool show_timing)
 
 void Cutflow::write(std::string output_dir)
 {
-    std::ofstream ofstream;
-    std::string output_cflow = output_dir+"/"+name+".cflow";
-    recursiveWrite(root, ofstream, output_cflow);
+    writeReports(output_dir, true, false, false);
     return;
 }
 
 void Cutflow::writeCSV(std::string output_dir)
 {
-    // Get rightmost terminal child
-    Cut* terminal_cut = recursiveFindTerminus(root);
-    // Open a new file
-    std::ofstream ofstream;
-    Utilities::CSVFile first_csv = Utilities::CSVFile(
-        ofstream,
-        output_dir+"/"+name+"_"+terminal_cut->name+".csv",
-        {"cut", "raw_events", "weighted_events"}
-    );
-    Utilities::CSVFiles csv_files = {first_csv};
-    // Write out next cutflow level
-    recursiveWriteCSV(output_dir, root, Right, 0, csv_files);
+    writeReports(output_dir, false, true, false);
     return;
 }
 
 void Cutflow::writeMermaid(std::string output_dir, std::string orientation)
 {
+    writeReports(output_dir, false, false, true, orientation);
+    return;
+}
+
+void Cutflow::writeAll(std::string output_dir, std::string orientation)
+{
+    writeReports(output_dir, true, true, true, orientation);
+    return;
+}
+
+void Cutflow::writeMultiWeightCSV(std::string output_dir)
+{
+    // Sort cuts in the order that they were added
+    std::vector<Cut*> cuts;
+    std::map<std::string, Cut*>::iterator iter;
+    for (iter = cut_record.begin(); iter != cut_record.end(); ++iter)
+    {
+        cuts.push_back((*iter).second);
+    }
+    std::sort(cuts.begin(), cuts.end(), [](Cut* cut1, Cut* cut2) { return cut1->id < cut2->id; });
+    // Format the whole table, then write it out at once
+    std::ostringstream table;
+    table << "cut,direction";
+    for (unsigned int weight_i = 0; weight_i < n_multi_weights; ++weight_i)
+    {
+        table << ",w" << weight_i;
+    }
+    table << std::endl;
+    for (auto* cut : cuts)
+    {
+        table << cut->name << ",pass";
+        for (auto& count : cut->n_pass_multiweighted) { table << "," << count; }
+        table << std::endl;
+        table << cut->name << ",fail";
+        for (auto& count : cut->n_fail_multiweighted) { table << "," << count; }
+        table << std::endl;
+    }
     std::ofstream ofstream;
-    std::string output_mmd = output_dir+"/"+name+".mmd";
-    // Write header
-    ofstream.open(output_mmd);
-    ofstream << "```mermaid" << std::endl;
-    ofstream << "graph " << orientation << std::endl;
+    ofstream.open(output_dir+"/"+name+"_multiweights.csv");
+    ofstream << table.str();
     ofstream.close();
-    // Write body
-    recursiveWriteMermaid(root, ofstream, output_mmd);
-    // Write footer
-    ofstream.open(output_mmd, std::ios::app);
-    ofstream << "```" << std::endl;
+    return;
+}
+
+void Cutflow::setSnapshot(std::string output_dir, unsigned int n_events, double seconds)
+{
+    if (n_events == 0 && seconds <= 0.)
+    {
+        std::string msg = "Error - either the number of events or seconds between snapshots must be set.";
+        throw std::runtime_error("Cutflow::setSnapshot: "+msg);
+    }
+    snapshots_enabled = true;
+    snapshot_dir = output_dir;
+    snapshot_n_events = n_events;
+    snapshot_seconds = seconds;
+    n_events_since_snapshot = 0;
+    last_snapshot_time = std::chrono::steady_clock::now();
+    return;
+}
+
+void Cutflow::waitForSnapshot()
+{
+    if (snapshot_writer.valid())
+    {
+        try
+        {
+            snapshot_writer.get();
+        }
+        catch (std::exception& e)
+        {
+            std::cout << "Cutflow::waitForSnapshot: Warning - snapshot failed: " << e.what() << std::endl;
+        }
+        snapshot_writer = std::shared_future<void>();
+    }
+    return;
+}
+
+void Cutflow::setMultiWeights(unsigned int new_n_multi_weights, 
+                              std::function<std::vector<double>()> new_multi_weights_lambda)
+{
+    n_multi_weights = new_n_multi_weights;
+    multi_weights_lambda = new_multi_weights_lambda;
+    multi_weights.assign(n_multi_weights, 0.);
+    std::map<std::string, Cut*>::iterator iter;
+    for (iter = cut_record.begin(); iter != cut_record.end(); ++iter)
+    {
+        (*iter).second->n_pass_multiweighted.assign(n_multi_weights, 0.);
+        (*iter).second->n_fail_multiweighted.assign(n_multi_weights, 0.);
+    }
+    return;
+}
+
+void Cutflow::merge(Cutflow& other, bool reset)
+{
+    if (cut_record.size() != other.cut_record.size())
+    {
+        std::string msg = "Error - "+other.name+" does not have the same cuts as "+name+".";
+        throw std::runtime_error("Cutflow::merge: "+msg);
+    }
+    if (n_multi_weights != other.n_multi_weights)
+    {
+        std::string msg = "Error - "+other.name+" does not have the same alternative weights as "+name+".";
+        throw std::runtime_error("Cutflow::merge: "+msg);
+    }
+    std::map<std::string, Cut*>::iterator iter;
+    for (iter = cut_record.begin(); iter != cut_record.end(); ++iter)
+    {
+        Cut* cut = (*iter).second;
+        if (other.cut_record.count(cut->name) == 0)
+        {
+            std::string msg = "Error - "+cut->name+" does not exist in "+other.name+".";
+            throw std::runtime_error("Cutflow::merge: "+msg);
+        }
+        Cut* other_cut = other.cut_record[cut->name];
+        cut->n_pass += other_cut->n_pass;
+        cut->n_fail += other_cut->n_fail;
+        cut->n_pass_weighted += other_cut->n_pass_weighted;
+        cut->n_fail_weighted += other_cut->n_fail_weighted;
+        cut->runtimes.merge(other_cut->runtimes);
+        for (unsigned int weight_i = 0; weight_i < n_multi_weights; ++weight_i)
+        {
+            cut->n_pass_multiweighted[weight_i] += other_cut->n_pass_multiweighted[weight_i];
+            cut->n_fail_multiweighted[weight_i] += other_cut->n_fail_multiweighted[weight_i];
+        }
+        if (reset)
+        {
+            other_cut->n_pass = 0;
+            other_cut->n_fail = 0;
+            other_cut->n_pass_weighted = 0.;
+            other_cut->n_fail_weighted = 0.;
+            other_cut->runtimes = Utilities::RunningStat();
+            other_cut->n_pass_multiweighted.assign(n_multi_weights, 0.);
+            other_cut->n_fail_multiweighted.assign(n_multi_weights, 0.);
+        }
+    }
+    return;
+}
+
+void Cutflow::writeBinary(std::string output_dir)
+{
+    std::string buffer = "RAPIDOCF";
+    // Values are written in the byte order of the host, which the marker records
+    Utilities::packValue<uint32_t>(buffer, 0x01020304);
+    Utilities::packValue<uint32_t>(buffer, 1);
+    Utilities::packValue<uint32_t>(buffer, cut_record.size());
+    Utilities::packValue<uint32_t>(buffer, n_multi_weights);
+    int n_packed = 0;
+    recursivePack(buffer, root, -1, Right, n_packed);
+    std::ofstream ofstream(output_dir+"/"+name+".bcflow", std::ios::binary);
+    ofstream.write(buffer.data(), buffer.size());
     ofstream.close();
     return;
 }
 
+void Cutflow::readBinary(std::string input_bcflow)
+{
+    // Read the entire file at once
+    std::ifstream ifstream(input_bcflow, std::ios::binary);
+    if (!ifstream.is_open())
+    {
+        std::string msg = "Error - could not open "+input_bcflow+".";
+        throw std::runtime_error("Cutflow::readBinary: "+msg);
+    }
+    std::string buffer((std::istreambuf_iterator<char>(ifstream)), std::istreambuf_iterator<char>());
+    ifstream.close();
+    if (buffer.compare(0, 8, "RAPIDOCF") != 0)
+    {
+        std::string msg = "Error - "+input_bcflow+" is not a binary cutflow file.";
+        throw std::runtime_error("Cutflow::readBinary: "+msg);
+    }
+    size_t offset = 8;
+    if (Utilities::unpackValue<uint32_t>(buffer, offset) != 0x01020304)
+    {
+        std::string msg = "Error - "+input_bcflow+" was written with a different byte order.";
+        throw std::runtime_error("Cutflow::readBinary: "+msg);
+    }
+    uint32_t version = Utilities::unpackValue<uint32_t>(buffer, offset);
+    if (version != 1)
+    {
+        std::string msg = "Error - "+input_bcflow+" has unsupported version "+std::to_string(version)+".";
+        throw std::runtime_error("Cutflow::readBinary: "+msg);
+    }
+    uint32_t n_cuts = Utilities::unpackValue<uint32_t>(buffer, offset);
+    uint32_t n_file_weights = Utilities::unpackValue<uint32_t>(buffer, offset);
+    // Unpack every cut before touching this cutflow, such that a bad file changes nothing
+    std::vector<Cut> cuts;
+    std::vector<int> parent_indices;
+    Directions directions;
+    // Names must be unique, and each cut can only have one left and one right child
+    std::map<std::string, int> cut_indices;
+    std::vector<int> filled_children; // 1: left child, 2: right child, 3: both
+    for (unsigned int cut_i = 0; cut_i < n_cuts; ++cut_i)
+    {
+        uint32_t name_size = Utilities::unpackValue<uint32_t>(buffer, offset);
+        if (offset + name_size > buffer.size())
+        {
+            std::string msg = "Error - "+input_bcflow+" is truncated.";
+            throw std::runtime_error("Cutflow::readBinary: "+msg);
+        }
+        Cut cut = Cut(buffer.substr(offset, name_size));
+        offset += name_size;
+        if (cut_indices.count(cut.name) == 1)
+        {
+            std::string msg = "Error - "+input_bcflow+" has more than one cut named "+cut.name+".";
+            throw std::runtime_error("Cutflow::readBinary: "+msg);
+        }
+        cut_indices[cut.name] = cut_i;
+        filled_children.push_back(0);
+        int parent_i = Utilities::unpackValue<int32_t>(buffer, offset);
+        if (parent_i >= int(cut_i) || (parent_i < 0) != (cut_i == 0))
+        {
+            std::string msg = "Error - "+input_bcflow+" has a bad parent for "+cut.name+".";
+            throw std::runtime_error("Cutflow::readBinary: "+msg);
+        }
+        uint8_t direction = Utilities::unpackValue<uint8_t>(buffer, offset);
+        int child = (direction == 0) ? 1 : 2;
+        if (direction > 1 || (cut_i > 0 && (filled_children[parent_i] & child) != 0))
+        {
+            std::string msg = "Error - "+input_bcflow+" has a bad direction for "+cut.name+".";
+            throw std::runtime_error("Cutflow::readBinary: "+msg);
+        }
+        if (cut_i > 0) { filled_children[parent_i] |= child; }
+        parent_indices.push_back(parent_i);
+        directions.push_back((direction == 0) ? Left : Right);
+        cut.n_pass = Utilities::unpackValue<int32_t>(buffer, offset);
+        cut.n_fail = Utilities::unpackValue<int32_t>(buffer, offset);
+        cut.n_pass_weighted = Utilities::unpackValue<double>(buffer, offset);
+        cut.n_fail_weighted = Utilities::unpackValue<double>(buffer, offset);
+        int n_runtimes = Utilities::unpackValue<int32_t>(buffer, offset);
+        float runtime_stats[5];
+        for (unsigned int stat_i = 0; stat_i < 5; ++stat_i)
+        {
+            runtime_stats[stat_i] = Utilities::unpackValue<float>(buffer, offset);
+        }
+        cut.runtimes = Utilities::RunningStat(
+            n_runtimes, runtime_stats[0], runtime_stats[1], runtime_stats[2], runtime_stats[3], 
+            runtime_stats[4]
+        );
+        for (unsigned int weight_i = 0; weight_i < n_file_weights; ++weight_i)
+        {
+            cut.n_pass_multiweighted.push_back(Utilities::unpackValue<double>(buffer, offset));
+        }
+        for (unsigned int weight_i = 0; weight_i < n_file_weights; ++weight_i)
+        {
+            cut.n_fail_multiweighted.push_back(Utilities::unpackValue<double>(buffer, offset));
+        }
+        cuts.push_back(cut);
+    }
+    if (root == nullptr)
+    {
+        // Rebuild cutflow
+        n_multi_weights = n_file_weights;
+        multi_weights.assign(n_multi_weights, 0.);
+        for (unsigned int cut_i = 0; cut_i < n_cuts; ++cut_i)
+        {
+            Cut* new_cut = new Cut(cuts[cut_i].name);
+            if (cut_i == 0) { setRoot(new_cut); }
+            else { insert(cuts[parent_indices[cut_i]].name, new_cut, directions[cut_i]); }
+        }
+    }
+    else
+    {
+        // Check that the cutflows are identical
+        if (n_cuts != cut_record.size())
+        {
+            std::string msg = "Error - "+input_bcflow+" does not have the same cuts as "+name+".";
+            throw std::runtime_error("Cutflow::readBinary: "+msg);
+        }
+        if (n_file_weights != n_multi_weights)
+        {
+            std::string msg = "Error - "+input_bcflow+" does not have the same alternative weights as "+name+".";
+            throw std::runtime_error("Cutflow::readBinary: "+msg);
+        }
+        for (unsigned int cut_i = 0; cut_i < n_cuts; ++cut_i)
+        {
+            bool matches = cut_record.count(cuts[cut_i].name) == 1;
+            if (matches)
+            {
+                Cut* cut = cut_record[cuts[cut_i].name];
+                if (cut_i == 0) { matches = cut == root; }
+                else
+                {
+                    Cut* parent = cut->parent;
+                    matches = (
+                        parent != nullptr && parent->name == cuts[parent_indices[cut_i]].name
+                        && cut == ((directions[cut_i] == Left) ? parent->left : parent->right)
+                    );
+                }
+            }
+            if (!matches)
+            {
+                std::string msg = "Error - "+cuts[cut_i].name+" in "+input_bcflow+" does not match "+name+".";
+                throw std::runtime_error("Cutflow::readBinary: "+msg);
+            }
+        }
+    }
+    // Add counts and runtimes
+    for (unsigned int cut_i = 0; cut_i < n_cuts; ++cut_i)
+    {
+        Cut* cut = cut_record[cuts[cut_i].name];
+        cut->n_pass += cuts[cut_i].n_pass;
+        cut->n_fail += cuts[cut_i].n_fail;
+        cut->n_pass_weighted += cuts[cut_i].n_pass_weighted;
+        cut->n_fail_weighted += cuts[cut_i].n_fail_weighted;
+        cut->runtimes.merge(cuts[cut_i].runtimes);
+        for (unsigned int weight_i = 0; weight_i < n_multi_weights; ++weight_i)
+        {
+            cut->n_pass_multiweighted[weight_i] += cuts[cut_i].n_pass_multiweighted[weight_i];
+            cut->n_fail_multiweighted[weight_i] += cuts[cut_i].n_fail_multiweighted[weight_i];
+        }
+    }
+    return;
+}
+
 Cut* Cutflow::getCut(std::string cut_name)
 {
     if (cut_record.count(cut_name) == 0)
@@ -445,6 +793,89 @@ Cut* Cutflow::getCut(std::string cut_name)
     }
 }
 
+void Cutflow::recordCut(Cut* new_cut)
+{
+    cut_record[new_cut->name] = new_cut;
+    new_cut->id = n_cuts_added;
+    n_cuts_added++;
+    new_cut->n_pass_multiweighted.assign(n_multi_weights, 0.);
+    new_cut->n_fail_multiweighted.assign(n_multi_weights, 0.);
+    return;
+}
+
+void Cutflow::checkSnapshot()
+{
+    n_events_since_snapshot++;
+    bool snapshot_is_due = (snapshot_n_events > 0 && n_events_since_snapshot >= snapshot_n_events);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!snapshot_is_due && snapshot_seconds > 0.)
+    {
+        std::chrono::duration<double> elapsed = now - last_snapshot_time;
+        snapshot_is_due = elapsed.count() >= snapshot_seconds;
+    }
+    if (!snapshot_is_due) { return; }
+    if (snapshot_writer.valid())
+    {
+        // Skip this event if the previous snapshot is still being written
+        if (snapshot_writer.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { return; }
+        waitForSnapshot();
+    }
+    snapshot_writer = std::async(std::launch::async, makeSnapshot()).share();
+    n_events_since_snapshot = 0;
+    last_snapshot_time = now;
+    return;
+}
+
+std::function<void()> Cutflow::makeSnapshot()
+{
+    std::vector<Cut> cuts;
+    std::map<std::string, Cut*>::iterator iter;
+    for (iter = cut_record.begin(); iter != cut_record.end(); ++iter)
+    {
+        cuts.push_back(*(*iter).second);
+    }
+    std::string output_csv = snapshot_dir+"/"+name+"_snapshot.csv";
+    return [cuts, output_csv]() { return writeSnapshotCSV(cuts, output_csv); };
+}
+
+void Cutflow::writeSnapshotCSV(std::vector<Cut> cuts, std::string output_csv)
+{
+    // Sort cuts in the order that they were added
+    std::sort(cuts.begin(), cuts.end(), [](const Cut& cut1, const Cut& cut2) { return cut1.id < cut2.id; });
+    std::ostringstream table;
+    table << "cut,raw_pass,raw_fail,weighted_pass,weighted_fail,";
+    table << "total_runtime_ms,max_runtime_ms,min_runtime_ms,mean_runtime_ms,stddev_runtime_ms" << std::endl;
+    for (auto& cut : cuts)
+    {
+        table << cut.name << "," << cut.n_pass << "," << cut.n_fail << ",";
+        table << cut.n_pass_weighted << "," << cut.n_fail_weighted << ",";
+        table << cut.runtimes.sum() << "," << cut.runtimes.max() << "," << cut.runtimes.min() << ",";
+        table << cut.runtimes.mean() << "," << cut.runtimes.stddev() << std::endl;
+    }
+    std::string tmp_csv = output_csv+".tmp";
+    std::ofstream ofstream;
+    ofstream.open(tmp_csv);
+    ofstream << table.str();
+    ofstream.close();
+    if (std::rename(tmp_csv.c_str(), output_csv.c_str()) != 0)
+    {
+        std::string msg = "Error - could not move "+tmp_csv+" to "+output_csv+".";
+        throw std::runtime_error("Cutflow::writeSnapshotCSV: "+msg);
+    }
+    return;
+}
+
+void Cutflow::countMultiWeights(std::vector<double>& counts, double weight)
+{
+    double* count_data = counts.data();
+    const double* weight_data = multi_weights.data();
+    for (unsigned int weight_i = 0; weight_i < n_multi_weights; ++weight_i)
+    {
+        count_data[weight_i] += weight*weight_data[weight_i];
+    }
+    return;
+}
+
 bool Cutflow::recursiveSearchProgeny(Cut* cut, Cut* target_cut)
 {
     if (cut->right != nullptr)
@@ -516,7 +947,8 @@ void Cutflow::recursivePrint(std::string tabs, Cut* cut, Direction direction, bo
 
 bool Cutflow::recursiveEvaluate(Cut* cut)
 {
-    if (debugger_is_set) { debugger(cut); }
+    RAPIDO_DEBUG_CUT(cut);
+    RAPIDO_TRACE_CUT(cut, CutRecord::Enter, 0.);
     // Start timer
     std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
     // Run cut logic and compute weight
@@ -526,11 +958,13 @@ bool Cutflow::recursiveEvaluate(Cut* cut)
     std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> runtime = t2 - t1;
     cut->runtimes.push(runtime.count());
+    RAPIDO_TRACE_CUT(cut, (passed) ? CutRecord::Pass : CutRecord::Fail, weight);
     // Continue down the tree
     if (passed)
     {
         cut->n_pass++;
         cut->n_pass_weighted += weight;
+        countMultiWeights(cut->n_pass_multiweighted, weight);
         if (cut->right == nullptr) { return true; }
         else { return recursiveEvaluate(cut->right); }
     }
@@ -538,6 +972,7 @@ bool Cutflow::recursiveEvaluate(Cut* cut)
     {
         cut->n_fail++;
         cut->n_fail_weighted += weight;
+        countMultiWeights(cut->n_fail_multiweighted, weight);
         if (cut->left == nullptr) { return false; }
         else { return recursiveEvaluate(cut->left); }
     }
@@ -554,105 +989,159 @@ void Cutflow::recursiveDelete(Cut* cut)
     return;
 }
 
-void Cutflow::recursiveWrite(Cut* cut, std::ofstream& ofstream, std::string output_cflow)
+void Cutflow::recursivePack(std::string& buffer, Cut* cut, int parent_i, Direction direction, 
+                            int& n_packed)
 {
-    if (cut != nullptr)
+    if (cut == nullptr) { return; }
+    int cut_i = n_packed;
+    n_packed++;
+    Utilities::packValue<uint32_t>(buffer, cut->name.size());
+    buffer += cut->name;
+    Utilities::packValue<int32_t>(buffer, parent_i);
+    Utilities::packValue<uint8_t>(buffer, (direction == Left) ? 0 : 1);
+    Utilities::packValue<int32_t>(buffer, cut->n_pass);
+    Utilities::packValue<int32_t>(buffer, cut->n_fail);
+    Utilities::packValue<double>(buffer, cut->n_pass_weighted);
+    Utilities::packValue<double>(buffer, cut->n_fail_weighted);
+    Utilities::packValue<int32_t>(buffer, cut->runtimes.size());
+    Utilities::packValue<float>(buffer, cut->runtimes.sum());
+    Utilities::packValue<float>(buffer, cut->runtimes.max());
+    Utilities::packValue<float>(buffer, cut->runtimes.min());
+    Utilities::packValue<float>(buffer, cut->runtimes.mean());
+    Utilities::packValue<float>(buffer, cut->runtimes.variance());
+    for (unsigned int weight_i = 0; weight_i < n_multi_weights; ++weight_i)
     {
-        if (cut == root) { ofstream.open(output_cflow); }
-        else { ofstream.open(output_cflow, std::ios::app); }
-        ofstream << cut->name << ",";
-        ofstream << cut->n_pass << "," << cut->n_pass_weighted << ",";
-        ofstream << cut->n_fail << "," << cut->n_fail_weighted << ",";
-        std::string parent_name = "null";
-        if (cut->parent != nullptr) { parent_name = cut->parent->name; }
-        std::string left_name = "null";
-        if (cut->left != nullptr) { left_name = cut->left->name; }
-        std::string right_name = "null";
-        if (cut->right != nullptr) { right_name = cut->right->name; }
-        ofstream << parent_name << "," << left_name << "," << right_name << std::endl;
-        // Print next cutflow level
-        ofstream.close();
-        recursiveWrite(cut->left, ofstream, output_cflow);
-        recursiveWrite(cut->right, ofstream, output_cflow);
+        Utilities::packValue<double>(buffer, cut->n_pass_multiweighted[weight_i]);
     }
+    for (unsigned int weight_i = 0; weight_i < n_multi_weights; ++weight_i)
+    {
+        Utilities::packValue<double>(buffer, cut->n_fail_multiweighted[weight_i]);
+    }
+    // Write out next cutflow level
+    recursivePack(buffer, cut->left, cut_i, Left, n_packed);
+    recursivePack(buffer, cut->right, cut_i, Right, n_packed);
     return;
 }
 
-void Cutflow::recursiveWriteCSV(std::string output_dir, Cut* cut, Direction direction, 
-                                int csv_idx, Utilities::CSVFiles csv_files)
+void Cutflow::writeReports(std::string output_dir, bool write_cflow, bool write_csv, 
+                          bool write_mmd, std::string orientation)
 {
-    if (cut != nullptr)
+    Utilities::ReportFiles reports;
+    int cflow_i = -1;
+    if (write_cflow) { cflow_i = reports.add(output_dir+"/"+name+".cflow"); }
+    int mmd_i = -1;
+    if (write_mmd) 
+    { 
+        mmd_i = reports.add(output_dir+"/"+name+".mmd", "```mermaid\ngraph "+orientation+"\n"); 
+    }
+    std::string csv_dir = "";
+    int csv_i = -1;
+    if (write_csv)
     {
-        Utilities::CSVFile this_csv = csv_files.at(csv_idx);
-        // Write out current cut
-        double raw_events = cut->n_pass;
-        double wgt_events = cut->n_pass_weighted;
-        if (direction == Right) { 
-            this_csv.pushCol<std::string>(cut->name);
-            this_csv.pushCol<double>(raw_events);
-            this_csv.pushCol<double>(wgt_events);
-            this_csv.writeRow();
-        }
-        else
-        {
-            csv_idx++;
-            // Get rightmost terminal child
-            Cut* terminal_cut = recursiveFindTerminus(cut);
-            // Open a new file
-            Utilities::CSVFile new_csv = this_csv.clone(
-                output_dir+"/"+name+"_"+terminal_cut->name+".csv"
-            );
-            new_csv.pushCol<std::string>(cut->name);
-            new_csv.pushCol<double>(raw_events);
-            new_csv.pushCol<double>(wgt_events);
-            new_csv.writeRow();
-            csv_files.push_back(new_csv);
-        }
-        // Write out next cutflow level
-        recursiveWriteCSV(output_dir, cut->left, Left, csv_idx, csv_files);
-        recursiveWriteCSV(output_dir, cut->right, Right, csv_idx, csv_files);
+        // Get rightmost terminal child
+        Cut* terminal_cut = recursiveFindTerminus(root);
+        csv_dir = output_dir+"/";
+        csv_i = reports.add(
+            csv_dir+name+"_"+terminal_cut->name+".csv", 
+            "cut,raw_events,weighted_events\n"
+        );
     }
-
+    recursiveWriteReports(reports, root, cflow_i, mmd_i, csv_dir, csv_i);
+    if (write_mmd) { reports.at(mmd_i) += "```\n"; }
+    reports.write();
     return;
 }
 
-
-void Cutflow::recursiveWriteMermaid(Cut* cut, std::ofstream& ofstream, std::string output_mmd)
+void Cutflow::recursiveWriteReports(Utilities::ReportFiles& reports, Cut* cut, int cflow_i, 
+                                    int mmd_i, std::string csv_dir, int csv_i)
 {
-    if (cut != nullptr)
+    if (cut == nullptr) { return; }
+    std::ostringstream lines;
+    if (cflow_i >= 0)
+    {
+        lines << cut->name << ",";
+        lines << cut->n_pass << "," << cut->n_pass_weighted << ",";
+        lines << cut->n_fail << "," << cut->n_fail_weighted << ",";
+        std::string parent_name = "null";
+        if (cut->parent != nullptr) { parent_name = cut->parent->name; }
+        std::string left_name = "null";
+        if (cut->left != nullptr) { left_name = cut->left->name; }
+        std::string right_name = "null";
+        if (cut->right != nullptr) { right_name = cut->right->name; }
+        lines << parent_name << "," << left_name << "," << right_name << std::endl;
+        reports.at(cflow_i) += lines.str();
+        lines.str("");
+    }
+    if (mmd_i >= 0)
     {
-        ofstream.open(output_mmd, std::ios::app);
         if (cut == root)
         {
-            ofstream << "    " << cut->name+"([\""+cut->name+" <br/> (root node)\"])" << std::endl;
+            lines << "    " << cut->name+"([\""+cut->name+" <br/> (root node)\"])" << std::endl;
         }
         // Write cut fails
         if (cut->parent != nullptr && cut == cut->parent->left)
         {
-            ofstream << "    " << cut->parent->name+"Fail --> "+cut->name+"{"+cut->name+"}" << std::endl;
+            lines << "    " << cut->parent->name+"Fail --> "+cut->name+"{"+cut->name+"}" << std::endl;
         }
-        ofstream << "    " << cut->name+" -- Fail --> "+cut->name+"Fail[/" << cut->n_fail << " raw";
-        if (cut->n_fail != cut->n_fail_weighted) { ofstream << " <br/> " << cut->n_fail_weighted << " wgt"; }
-        ofstream << "/]" << std::endl;
+        lines << "    " << cut->name+" -- Fail --> "+cut->name+"Fail[/" << cut->n_fail << " raw";
+        if (cut->n_fail != cut->n_fail_weighted) { lines << " <br/> " << cut->n_fail_weighted << " wgt"; }
+        lines << "/]" << std::endl;
         // Write cut passes
         if (cut->parent != nullptr && cut == cut->parent->right)
         {
-            ofstream << "    " << cut->parent->name+"Pass --> "+cut->name+"{"+cut->name+"}" << std::endl;
+            lines << "    " << cut->parent->name+"Pass --> "+cut->name+"{"+cut->name+"}" << std::endl;
         }
-        ofstream << "    " << cut->name+" -- Pass --> "+cut->name+"Pass[/" << cut->n_pass << " raw";
-        if (cut->n_pass != cut->n_pass_weighted) { ofstream << " <br/> " << cut->n_pass_weighted << " wgt"; }
-        ofstream << "/]" << std::endl;
-        // Print next cutflow level
-        ofstream.close();
-        recursiveWriteMermaid(cut->left, ofstream, output_mmd);
-        recursiveWriteMermaid(cut->right, ofstream, output_mmd);
+        lines << "    " << cut->name+" -- Pass --> "+cut->name+"Pass[/" << cut->n_pass << " raw";
+        if (cut->n_pass != cut->n_pass_weighted) { lines << " <br/> " << cut->n_pass_weighted << " wgt"; }
+        lines << "/]" << std::endl;
+        reports.at(mmd_i) += lines.str();
     }
+    if (csv_i >= 0)
+    {
+        std::string row = cut->name+","+std::to_string(double(cut->n_pass))+","
+                          +std::to_string(double(cut->n_pass_weighted))+"\n";
+        if (cut->parent != nullptr && cut == cut->parent->left)
+        {
+            // Start a new file for this path that begins with every cut up to this one
+            Cut* terminal_cut = recursiveFindTerminus(cut);
+            csv_i = reports.add(
+                csv_dir+name+"_"+terminal_cut->name+".csv", 
+                reports.at(csv_i)+row
+            );
+        }
+        else { reports.at(csv_i) += row; }
+    }
+    // Write out next cutflow level
+    recursiveWriteReports(reports, cut->left, cflow_i, mmd_i, csv_dir, csv_i);
+    recursiveWriteReports(reports, cut->right, cflow_i, mmd_i, csv_dir, csv_i);
     return;
 }
 
 void Cutflow::setDebugLambda(std::function<void(Cut*)> new_debugger)
 {
+#ifdef RAPIDO_NO_DEBUG
+    std::cout << "Cutflow::setDebugLambda: Warning - compiled with RAPIDO_NO_DEBUG, ";
+    std::cout << "debugger will not be run" << std::endl;
+#endif
     debugger = new_debugger;
     debugger_is_set = true;
     return;
 }
+
+#ifdef RAPIDO_TRACE
+void Cutflow::dumpTrace()
+{
+    std::cout << "Cutflow trace (last " << trace.size() << " records on this thread):" << std::endl;
+    for (unsigned int record_i = 0; record_i < trace.size(); ++record_i)
+    {
+        CutRecord& record = trace.at(record_i);
+        std::cout << " - event " << record.event << ": ";
+        if (record.stage == CutRecord::Enter) { std::cout << "enter " << record.cut_name; }
+        else if (record.stage == CutRecord::Pass) { std::cout << "pass  " << record.cut_name; }
+        else { std::cout << "fail  " << record.cut_name; }
+        if (record.stage != CutRecord::Enter) { std::cout << " (wgt: " << record.weight << ")"; }
+        std::cout << std::endl;
+    }
+    return;
+}
+#endif
@@ -8,9 +8,40 @@
 #include <vector>
 #include <map>
 #include <chrono>
+#include <future>
+#include <cstdio>
+#include <sstream>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 
 #include "utilities.h"
 
+/**
+ * Compile-time debugging switches:
+ *   RAPIDO_NO_DEBUG   removes the Cutflow::setDebugLambda hook from the event loop entirely
+ *   RAPIDO_TRACE      records every cut evaluation in a per-thread ring buffer that is dumped 
+ *                     if an exception escapes Cutflow::run
+ *   RAPIDO_TRACE_SIZE number of records kept per thread (default: 1024)
+ * These must be set identically when compiling RAPIDO and any code that includes it
+ */
+#ifndef RAPIDO_TRACE_SIZE
+#define RAPIDO_TRACE_SIZE 1024
+#endif
+
+#ifdef RAPIDO_NO_DEBUG
+#define RAPIDO_DEBUG_CUT(cut)
+#else
+#define RAPIDO_DEBUG_CUT(cut) if (debugger_is_set) { debugger(cut); }
+#endif
+
+#ifdef RAPIDO_TRACE
+#define RAPIDO_TRACE_CUT(cut, stage, weight) Cutflow::trace.push(CutRecord(Cutflow::n_traced_events, cut, stage, weight))
+#else
+#define RAPIDO_TRACE_CUT(cut, stage, weight)
+#endif
+
 enum Direction
 {
     Left,
@@ -40,8 +71,14 @@ public:
     double n_pass_weighted;
     /** Weighted number of events that fail cut */
     double n_fail_weighted;
+    /** Weighted number of events that pass cut for each alternative weight (see Cutflow::setMultiWeights) */
+    std::vector<double> n_pass_multiweighted;
+    /** Weighted number of events that fail cut for each alternative weight (see Cutflow::setMultiWeights) */
+    std::vector<double> n_fail_multiweighted;
     /** RunningStat object for cut runtimes */
     Utilities::RunningStat runtimes;
+    /** Index of cut in its cutflow (assigned when the cut is added to a cutflow) */
+    int id;
 
     /**
      * Cut object constructor
@@ -144,6 +181,47 @@ public:
     double weight();
 };
 
+/**
+ * Fixed-size record of a single step in the evaluation of a cut (see RAPIDO_TRACE)
+ */
+struct CutRecord
+{
+    /** Stage of cut evaluation that was recorded */
+    enum Stage
+    {
+        Enter,
+        Pass,
+        Fail
+    };
+    /** Index of event (i.e. number of Cutflow::run calls on this thread) */
+    unsigned long event;
+    /** 
+     * Name of evaluated cut (truncated to 63 characters); the name is copied, since the 
+     * trace is shared by every cutflow on the thread, which may be deleted before it is dumped
+     */
+    char cut_name[64];
+    /** Stage of evaluation */
+    Stage stage;
+    /** Event weight computed by the cut (zero when entering the cut) */
+    double weight;
+
+    /**
+     * CutRecord object default constructor (empty record)
+     * @return none
+     */
+    CutRecord();
+
+    /**
+     * CutRecord object constructor
+     * @param new_event index of event
+     * @param cut pointer to evaluated cut
+     * @param new_stage stage of evaluation
+     * @param new_weight event weight computed by the cut
+     * @return none
+     */
+    CutRecord(unsigned long new_event, Cut* cut, Stage new_stage, double new_weight);
+};
+
 /** 
  * An analysis represented as a binary search tree (i.e. analysis = tree, cut = node)
  */
@@ -154,10 +232,38 @@ protected:
     Cut* root;
     /** (PROTECTED) Map ("record") of all cuts in cutflow */
     std::map<std::string, Cut*> cut_record;
+    /** (PROTECTED) Number of cuts that have been added to the cutflow (used to assign Cut::id) */
+    int n_cuts_added;
     /** (PROTECTED) Lambda function that runs before every cut for debugging purposes */
     std::function<void(Cut*)> debugger;
     /** (PROTECTED) Flag indicating that a debugger lambda function has been set */
     bool debugger_is_set;
+    /** (PROTECTED) Number of alternative weights per event (zero if not set) */
+    unsigned int n_multi_weights;
+    /** (PROTECTED) Lambda function that computes the alternative weights of an event */
+    std::function<std::vector<double>()> multi_weights_lambda;
+    /** (PROTECTED) Alternative weights of the current event */
+    std::vector<double> multi_weights;
+    /** (PROTECTED) Flag indicating that snapshots are written during the run */
+    bool snapshots_enabled;
+    /** (PROTECTED) Target directory for snapshots */
+    std::string snapshot_dir;
+    /** (PROTECTED) Number of events between snapshots (zero if not used) */
+    unsigned int snapshot_n_events;
+    /** (PROTECTED) Number of seconds between snapshots (zero if not used) */
+    double snapshot_seconds;
+    /** (PROTECTED) Number of events run since the last snapshot */
+    unsigned int n_events_since_snapshot;
+    /** (PROTECTED) Time of the last snapshot */
+    std::chrono::steady_clock::time_point last_snapshot_time;
+    /** (PROTECTED) Background task writing the most recent snapshot */
+    std::shared_future<void> snapshot_writer;
+#ifdef RAPIDO_TRACE
+    /** (PROTECTED) Records of the most recent cut evaluations on this thread */
+    static thread_local Utilities::RingBuffer<CutRecord, RAPIDO_TRACE_SIZE> trace;
+    /** (PROTECTED) Number of events run on this thread */
+    static thread_local unsigned long n_traced_events;
+#endif
 
     /**
      * (PROTECTED) Retrieve cut object from cut record
@@ -166,6 +272,44 @@ protected:
      */
     Cut* getCut(std::string cut_name);
 
+    /**
+     * (PROTECTED) Add cut object to cut record and assign it a new id
+     * @param new_cut pointer to cut
+     * @return none
+     */
+    void recordCut(Cut* new_cut);
+
+    /**
+     * (PROTECTED) Start writing a snapshot in the background if one is due and the previous 
+     * snapshot has been written (otherwise, try again after the next event)
+     * @return none
+     */
+    void checkSnapshot();
+
+    /**
+     * (PROTECTED) Copy everything that goes into a snapshot; this runs on the thread that 
+     * runs the cutflow, but the function it returns is run on a background thread
+     * @return function that writes the copied state to the snapshot file(s)
+     */
+    virtual std::function<void()> makeSnapshot();
+
+    /**
+     * (PROTECTED) Write the counts and runtimes of a copy of every cut to a CSV file; the file
+     * is written under a temporary name, then renamed, such that it is always complete
+     * @param cuts copies of cuts
+     * @param output_csv path to output CSV file
+     * @return none
+     */
+    static void writeSnapshotCSV(std::vector<Cut> cuts, std::string output_csv);
+
+    /**
+     * (PROTECTED) Add the current alternative weights, times a given weight, to a set of counts
+     * @param counts weighted counts for each alternative weight
+     * @param weight weight to multiply each alternative weight by
+     * @return none
+     */
+    void countMultiWeights(std::vector<double>& counts, double weight);
+
     /**
      * (PROTECTED) Recursively search for the target cut amongst a given cut's descendants
      * @param cut pointer to current cut
@@ -192,34 +336,43 @@ protected:
     void recursivePrint(std::string tabs, Cut* cut, Direction direction, bool show_timing = false);
 
     /**
-     * (PROTECTED) Recursively write RAPIDO cutflow file
+     * (PROTECTED) Recursively build the requested cutflow reports in memory
+     * @param reports Utilities::ReportFiles object that holds the reports
      * @param cut pointer to current cut
-     * @param ofstream std::ofsteam object for RAPIDO .cflow file
-     * @param output_cflow name of .cflow file
+     * @param cflow_i index of RAPIDO .cflow file in reports (skipped if negative)
+     * @param mmd_i index of Mermaid .mmd file in reports (skipped if negative)
+     * @param csv_dir target directory for output CSV files (CSV files skipped if empty)
+     * @param csv_i index of CSV file for the path that this cut is on
      * @return none
      */
-    void recursiveWrite(Cut* cut, std::ofstream& ofstream, std::string output_cflow);
+    void recursiveWriteReports(Utilities::ReportFiles& reports, Cut* cut, int cflow_i, int mmd_i, 
+                               std::string csv_dir = "", int csv_i = -1);
 
     /**
-     * (PROTECTED) Recursively write cutflow level to CSV file(s)
-     * @param output_dir target directory for output CSV files
+     * (PROTECTED) Recursively append the binary record of each cut to a buffer (pre-order, 
+     * such that every cut comes after its parent; see Cutflow::writeBinary)
+     * @param buffer buffer to append to
      * @param cut pointer to current cut
+     * @param parent_i index of parent cut in buffer (-1 for root)
      * @param direction direction of cut relative to parent
-     * @param csv_idx index of target CSV file
-     * @param csv_files Utilities::CSVFile object containing for all currently opened CSV files
+     * @param n_packed number of cuts appended so far
      * @return none
      */
-    void recursiveWriteCSV(std::string output_dir, Cut* cut, Direction direction, int csv_idx, 
-                           Utilities::CSVFiles csv_files);
+    void recursivePack(std::string& buffer, Cut* cut, int parent_i, Direction direction, 
+                       int& n_packed);
 
     /**
-     * (PROTECTED) Recursively write cutflow to a Mermaid (.mmd) file
-     * @param cut pointer to current cut
-     * @param ofstream std::ofstream object for .mmd file
-     * @param output_mmd name of .mmd file
+     * (PROTECTED) Build the requested cutflow reports in memory with a single traversal, then 
+     * write each one to disk with a single write
+     * @param output_dir target directory for output files
+     * @param write_cflow toggle RAPIDO .cflow file
+     * @param write_csv toggle CSV files
+     * @param write_mmd toggle Mermaid .mmd file
+     * @param orientation desired orientation of Mermaid graph: TD or LR (optional)
      * @return none
      */
-    void recursiveWriteMermaid(Cut* cut, std::ofstream& ofstream, std::string output_mmd);
+    void writeReports(std::string output_dir, bool write_cflow, bool write_csv, bool write_mmd,
+                      std::string orientation = "TD");
 
     /**
      * (PROTECTED) Recursively evaulate cuts in the cutflow
@@ -426,12 +579,105 @@ public:
      */
     void writeMermaid(std::string output_dir = "", std::string orientation = "TD");
 
+    /**
+     * Write RAPIDO cutflow file, CSV files, and Mermaid flowchart all at once (equivalent to 
+     * calling Cutflow::write, Cutflow::writeCSV, and Cutflow::writeMermaid, but the cutflow 
+     * is only traversed once)
+     * @param output_dir target directory for output files (optional)
+     * @param orientation desired orientation of Mermaid graph: TD or LR (optional)
+     * @return none
+     */
+    void writeAll(std::string output_dir = "", std::string orientation = "TD");
+
+    /**
+     * Write the pass and fail counts of every cut for each alternative weight to a single 
+     * CSV file {output_dir}/{name}_multiweights.csv
+     * @param output_dir target directory for output CSV file (optional)
+     * @return none
+     */
+    void writeMultiWeightCSV(std::string output_dir = "");
+
+    /**
+     * Write the cutflow to a binary file {output_dir}/{name}.bcflow that keeps the full 
+     * precision of every count, the runtimes, and the alternative weight counts, and can be 
+     * read back with Cutflow::readBinary on a host with the same byte order. The layout 
+     * (byte order of the host) is
+     *   header: "RAPIDOCF", byte order marker (uint32 0x01020304), version (uint32), number 
+     *           of cuts (uint32), number of alternative weights (uint32)
+     *   cuts (parents before children): name length (uint32), name, parent index (int32;
+     *           -1 for root), direction (uint8), n_pass, n_fail (int32), n_pass_weighted, 
+     *           n_fail_weighted (double), runtimes size (int32), sum, max, min, mean, 
+     *           variance (float), n_pass_multiweighted, n_fail_multiweighted (double each)
+     * @param output_dir target directory for output file (optional)
+     * @return none
+     */
+    void writeBinary(std::string output_dir = "");
+
+    /**
+     * Read a binary cutflow file (see Cutflow::writeBinary), which is checked in full before 
+     * this cutflow is changed; if this cutflow is empty, the cuts are rebuilt (as Cut objects 
+     * that always pass, i.e. only for their counts), otherwise the cuts must be identical and 
+     * the counts and runtimes are added to this cutflow, as in Cutflow::merge
+     * @param input_bcflow path to binary cutflow file
+     * @return none
+     */
+    void readBinary(std::string input_bcflow);
+
+    /**
+     * Set alternative event weights (e.g. PDF and scale variations); these are computed once
+     * per event, and each cut keeps a weighted count for each of them, where every 
+     * alternative weight is multiplied by the weight of the cut as well
+     * @param new_n_multi_weights number of alternative weights
+     * @param new_multi_weights_lambda lambda function that computes the alternative weights
+     * @return none
+     */
+    virtual void setMultiWeights(unsigned int new_n_multi_weights, 
+                                 std::function<std::vector<double>()> new_multi_weights_lambda);
+
+    /**
+     * Add the counts and runtimes of another cutflow with the same cuts to this one (e.g. 
+     * one cutflow per worker thread, merged after the workers are done); no locking is 
+     * done, so the other cutflow must not be running while it is merged
+     * @param other cutflow to merge into this one
+     * @param reset reset the counts and runtimes of the other cutflow after merging (optional)
+     * @return none
+     */
+    void merge(Cutflow& other, bool reset = false);
+
+    /**
+     * Periodically write a snapshot of the cutflow (counts and runtimes of every cut) to 
+     * {output_dir}/{name}_snapshot.csv while running; the state is copied after the event that 
+     * triggers the snapshot, then written on a background thread, so the event loop is not 
+     * stalled. Each file is written under a temporary name and renamed, so a snapshot that
+     * is read while another is being written is always complete
+     * @param output_dir target directory for snapshots
+     * @param n_events number of events between snapshots (zero to only use seconds)
+     * @param seconds number of seconds between snapshots (optional; zero to only use n_events)
+     * @return none
+     */
+    virtual void setSnapshot(std::string output_dir, unsigned int n_events, double seconds = 0.);
+
+    /**
+     * Wait for the snapshot that is currently being written (if any) to finish
+     * @return none
+     */
+    void waitForSnapshot();
+
     /**
      * Set debug function
      * @param new_debugger lambda function that will be run before every cut
      * @return none
      */
     void setDebugLambda(std::function<void(Cut*)> new_debugger);
+
+#ifdef RAPIDO_TRACE
+    /**
+     * Print the most recent cut evaluations recorded on this thread (oldest first); this 
+     * is called automatically if an exception escapes Cutflow::run
+     * @return none
+     */
+    static void dumpTrace();
+#endif
 };
 
 #endif
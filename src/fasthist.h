@@ -0,0 +1,128 @@
+#ifndef FASTHIST_H
+#define FASTHIST_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TH1.h"
+#include "TAxis.h"
+
+/**
+ * Lightweight 1D or 2D histogram with uniform binning and contiguous bin storage that is
+ * used in place of ROOT's TH1::Fill in the event loop.
+ *
+ * Fills are staged and binned in batches (a multiply-and-clamp per value), and the contents
+ * are only added to the ROOT histogram it was made from when FastHist::flush is called.
+ * Bins follow the ROOT convention (0 is underflow, n_bins + 1 is overflow), and the
+ * statistics (entries, sum of weights, etc.) are accumulated as TH1::Fill would.
+ */
+class FastHist
+{
+protected:
+    /** Pointer to ROOT histogram that contents are flushed to */
+    TH1* target;
+    /** Number of dimensions (1 or 2) */
+    int n_dims;
+    /** Number of bins along x (not counting underflow and overflow) */
+    int n_bins_x;
+    /** Number of bins along y (not counting underflow and overflow) */
+    int n_bins_y;
+    /** Lower edge of x axis */
+    double x_min;
+    /** Number of x bins per unit x */
+    double x_scale;
+    /** Lower edge of y axis */
+    double y_min;
+    /** Number of y bins per unit y */
+    double y_scale;
+    /** Sum of weights in each bin (same global bin numbering as ROOT) */
+    std::vector<double> sumw;
+    /** Sum of squared weights in each bin (same global bin numbering as ROOT) */
+    std::vector<double> sumw2;
+    /** Statistics in the same order as TH1::GetStats */
+    double stats[7];
+    /** Number of fills */
+    double n_entries;
+    /** Flag indicating that a weight other than 1 has been filled */
+    bool has_weights;
+    /** Staged x values */
+    std::vector<double> staged_x;
+    /** Staged y values */
+    std::vector<double> staged_y;
+    /** Staged weights */
+    std::vector<double> staged_w;
+    /** Global bin numbers of staged fills */
+    std::vector<int> staged_bins;
+    /** Number of staged fills */
+    unsigned int n_staged;
+
+    /**
+     * (PROTECTED) Bin all staged fills and add them to the bin contents and statistics
+     * @return none
+     */
+    void binStaged();
+
+public:
+    /** Number of fills that are staged before they are binned */
+    static const unsigned int batch_size = 256;
+
+    /**
+     * Check that a ROOT histogram can be used by a FastHist, i.e. that it has the given 
+     * number of dimensions and uniform binning
+     * @param hist pointer to ROOT histogram
+     * @param n_dims required number of dimensions (1 or 2)
+     * @return none
+     */
+    static void checkHist(TH1* hist, int n_dims);
+
+    /**
+     * FastHist object constructor
+     * @param new_target pointer to a uniformly binned 1D or 2D ROOT histogram
+     * @return none
+     */
+    FastHist(TH1* new_target);
+
+    /**
+     * FastHist object destructor
+     * @return none
+     */
+    virtual ~FastHist();
+
+    /**
+     * Fill 1D histogram
+     * @param x value
+     * @param weight weight
+     * @return none
+     */
+    void fill(double x, double weight = 1.);
+
+    /**
+     * Fill 2D histogram
+     * @param x value along x axis
+     * @param y value along y axis
+     * @param weight weight
+     * @return none
+     */
+    void fill(double x, double y, double weight);
+
+    /**
+     * Fill 1D histogram with many values at once
+     * @param n_values number of values
+     * @param x values
+     * @param weights weights (if nullptr, all weights are 1)
+     * @return none
+     */
+    void fillN(unsigned int n_values, const double* x, const double* weights = nullptr);
+
+    /**
+     * Add the contents and statistics of this histogram to its ROOT histogram, then reset
+     * @return none
+     */
+    void flush();
+};
+
+#include "fasthist.icc"
+
+#endif
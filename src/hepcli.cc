@@ -1,6 +1,11 @@
 #include "hepcli.h"
 
-HEPCLI::HEPCLI() {}
+HEPCLI::HEPCLI() 
+{
+    output_basket_size = 0;
+    output_auto_flush = 0;
+    output_auto_save = 0;
+}
 
 HEPCLI::HEPCLI(int argc, char** argv)
 {
@@ -8,6 +13,9 @@ HEPCLI::HEPCLI(int argc, char** argv)
     output_dir = "output";
     output_name = "output";
     output_ttree = "tree";
+    output_basket_size = 0;
+    output_auto_flush = 0;
+    output_auto_save = 0;
     variation = "nominal";
     is_data = false;
     is_signal = false;
@@ -47,6 +55,18 @@ void HEPCLI::printHelp()
     std::cout << std::setw(25) << "  -s, --scale_factor";
     std::cout << std::setw(50) << "global event weight";
     std::cout << std::endl;
+    std::cout << std::setw(25) << "  --compression";
+    std::cout << std::setw(50) << "output compression as ALGORITHM[:LEVEL] (e.g. 'LZ4', 'ZSTD:5', 'LZMA:8')";
+    std::cout << std::endl;
+    std::cout << std::setw(25) << "  --basket_size";
+    std::cout << std::setw(50) << "basket size of output branches in bytes";
+    std::cout << std::endl;
+    std::cout << std::setw(25) << "  --auto_flush";
+    std::cout << std::setw(50) << "flush output baskets every N entries (N > 0) or -N bytes (N < 0)";
+    std::cout << std::endl;
+    std::cout << std::setw(25) << "  --auto_save";
+    std::cout << std::setw(50) << "save output ttree header every N entries (N > 0) or -N bytes (N < 0)";
+    std::cout << std::endl;
     std::cout << std::setw(25) << "  --is_data" << std::setw(50) << "data flag";
     std::cout << std::endl;
     std::cout << std::setw(25) << "  --is_signal" << std::setw(50) << "signal flag";
@@ -75,6 +95,11 @@ void HEPCLI::parse(int argc, char** argv)
         {"is_data", no_argument, &is_data_flag, 1},
         {"is_signal", no_argument, &is_signal_flag, 1},
         {"debug", no_argument, &debug_flag, 1},
+        {"compression", required_argument, 0, 'c'},
+        {"basket_size", required_argument, 0, 'b'},
+        {"auto_flush", required_argument, 0, 'f'},
+        {"auto_save", required_argument, 0, 'a'},
+        {0, 0, 0, 0}
     };
 
     // Parse CLI input
@@ -105,6 +130,18 @@ void HEPCLI::parse(int argc, char** argv)
             case 's':
                 scale_factor = std::atof(optarg);
                 break;
+            case 'c':
+                output_compression = optarg;
+                break;
+            case 'b':
+                output_basket_size = std::atoi(optarg);
+                break;
+            case 'f':
+                output_auto_flush = std::atoll(optarg);
+                break;
+            case 'a':
+                output_auto_save = std::atoll(optarg);
+                break;
             case 'h':
                 printHelp();
                 exit(EXIT_SUCCESS);
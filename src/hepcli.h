@@ -38,6 +38,14 @@ public:
     std::string output_name;
     /** Name of TTree in output ROOT file */
     std::string output_ttree;
+    /** Compression of output ROOT file as 'ALGORITHM[:LEVEL]' (empty: ROOT default) */
+    std::string output_compression;
+    /** Basket size of output TTree branches in bytes (0: ROOT default) */
+    int output_basket_size;
+    /** AutoFlush threshold of output TTree (> 0: entries, < 0: bytes, 0: ROOT default) */
+    long long output_auto_flush;
+    /** AutoSave threshold of output TTree (> 0: entries, < 0: bytes, 0: ROOT default) */
+    long long output_auto_save;
     /** Variation type (e.g. "up", "down", "nominal", ...) */
     std::string variation;
     /** Data (as opposed to Monte Carlo) flag */
@@ -3,8 +3,15 @@
 
 #include <functional>
 #include <map>
+#include <memory>
+
+#include "TH1.h"
+#include "TFile.h"
+#include "TROOT.h"
 
 #include "cutflow.h"
+#include "fasthist.h"
+#include "multiweighthist.h"
 #include "utilities.h"
 
 /** 
@@ -16,8 +23,36 @@ class Histflow : public Cutflow
 protected:
     /** "Schedule" dictating when to fill certain histograms */
     std::map<std::string, std::vector<std::function<void(double)>>> fill_schedule;
+    /** Fill schedule resolved for each cut, indexed by Cut::id (nullptr if nothing to fill) */
+    std::vector<std::vector<std::function<void(double)>>*> fill_plan;
+    /** Flag indicating that the fill plan must be rebuilt before the next event */
+    bool fill_plan_is_stale;
     /** Collection of functions that write histograms to opened TFile */
     std::map<TString, std::function<void()>> hist_writers;
+    /** All booked histograms, in the order that they were booked (nullptr until first filled) */
+    std::vector<TH1*> hists;
+    /** Names of all booked histograms, in the order that they were booked */
+    std::vector<TString> hist_names;
+    /** Histogram that each booked histogram is cloned from when it is first filled */
+    std::vector<TH1*> hist_prototypes;
+    /** Copy of every distinct histogram passed to a booking, keyed by the original histogram */
+    std::map<TH1*, TH1*> prototypes;
+    /** All copies of histograms passed to a booking */
+    std::vector<TH1*> owned_prototypes;
+    /** Fast histograms that are filled in place of booked histograms */
+    std::vector<FastHist*> fast_hists;
+    /** Histograms that are filled once for each alternative weight */
+    std::vector<MultiWeightHist*> multi_weight_hists;
+    /** Index of each named fill variable */
+    std::map<std::string, unsigned int> fill_var_ids;
+    /** Lambda functions that compute each named fill variable */
+    std::vector<std::function<double()>> fill_var_lambdas;
+    /** Value of each named fill variable (only valid for the event it was computed for) */
+    std::vector<double> fill_var_values;
+    /** Event that each named fill variable was last computed for */
+    std::vector<unsigned long> fill_var_events;
+    /** Number of events run (used to tell whether a fill variable is up to date) */
+    unsigned long n_events_run;
 
     /**
      * (PROTECTED) Additional definition that recursively evaluates cuts in cutflow and 
@@ -28,13 +63,82 @@ protected:
     bool recursiveEvaluate(Cut* cut) override;
 
     /**
-     * (PROTECTED) Handle internal scheduling for Histflow::bookHist1D and Histflow::bookHist2D
+     * (PROTECTED) Resolve the fill schedule into the fill plan, such that the histograms to
+     * fill after each cut can be found without any lookups in the event loop
+     * @return none
+     */
+    void buildFillPlan();
+
+    /**
+     * (PROTECTED) Handle internal scheduling for Histflow::bookHist1D and Histflow::bookHist2D;
+     * the new histogram is not allocated until it is first filled (see Histflow::getHist)
      * @param target_cut_name target node name
-     * @param hist pointer to 1D ROOT histogram to schedule
-     * @return pointer to new copy of input histogram
+     * @param hist pointer to ROOT histogram to schedule
+     * @return index of new histogram
+     */
+    unsigned int bookHist(std::string target_cut_name, TH1* hist);
+
+    /**
+     * (PROTECTED) Get the index of a named fill variable
+     * @param var_name name of fill variable
+     * @return index of fill variable
+     */
+    unsigned int getFillVarID(std::string var_name);
+
+    /**
+     * (PROTECTED) Get the value of a named fill variable for the current event, computing 
+     * it if it has not been computed for this event yet
+     * @param var_i index of fill variable
+     * @return value of fill variable
+     */
+    double getFillVar(unsigned int var_i);
+
+    /**
+     * (PROTECTED) Check whether a histogram is defined identically to another one (name, 
+     * title, axes, number of entries, and sum of squared weights), i.e. whether a copy of one 
+     * can stand in for a copy of the other
+     * @param hist pointer to histogram
+     * @param other_hist pointer to other histogram
+     * @return whether the histograms are defined identically
+     */
+    static bool isSameHist(TH1* hist, TH1* other_hist);
+
+    /**
+     * (PROTECTED) Allocate a booked histogram by cloning its prototype
+     * @param hist_i index of booked histogram
+     * @return pointer to new histogram
+     */
+    TH1* allocateHist(unsigned int hist_i);
+
+    /**
+     * (PROTECTED) Get a booked histogram, allocating it if it has not been filled yet
+     * @param hist_i index of booked histogram
+     * @return pointer to booked histogram
      */
     template<typename THist>
-    THist* bookHist(std::string target_cut_name, THist* hist);
+    THist* getHist(unsigned int hist_i);
+
+    /**
+     * (PROTECTED) Handle internal scheduling for Histflow::bookMultiWeightHist1D and 
+     * Histflow::bookMultiWeightHist2D
+     * @param target_cut_name target node name
+     * @param hist pointer to ROOT histogram to schedule
+     * @return pointer to new set of histograms
+     */
+    MultiWeightHist* bookMultiWeightHist(std::string target_cut_name, TH1* hist);
+
+    /**
+     * (PROTECTED) Copy the cut counts, runtimes, and every filled histogram for a snapshot
+     * @see Cutflow::makeSnapshot
+     * @return function that writes the copied state to the snapshot files
+     */
+    std::function<void()> makeSnapshot() override;
+
+    /**
+     * (PROTECTED) Add the contents of every fast histogram to its booked ROOT histogram
+     * @return none
+     */
+    void flushFastHists();
 
 public:
     /**
@@ -58,6 +162,25 @@ public:
      */
     ~Histflow();
 
+    using Cutflow::run;
+
+    /**
+     * Run cutflow until any terminus, filling histograms along the way; rebuilds the fill 
+     * plan first if any histograms or cuts were added since the last event
+     * @return whether or not (true/false) the final terminus passed
+     */
+    bool run() override;
+
+    /**
+     * Define a named fill variable that can be used by any number of bookings (e.g. 
+     * bookHist1D(cut, hist, "lep_pt")), where it is computed at most once per event, no 
+     * matter how many histograms are filled with it
+     * @param var_name name of fill variable
+     * @param var_lambda lambda function that computes the fill variable
+     * @return none
+     */
+    void defineFillVar(std::string var_name, std::function<double()> var_lambda);
+
     /**
      * Schedule a ROOT 1D histogram for a given cut
      * @param target_cut_name target node name
@@ -102,6 +225,165 @@ public:
     template<typename THist1D>
     void bookHist1D(Cut* target_cut, THist1D* hist, std::function<double()> fill_lambda);
 
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a named fill variable
+     * (see Histflow::defineFillVar)
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param var_name name of fill variable
+     * @return none
+     */
+    template<typename THist1D>
+    void bookHist1D(std::string target_cut_name, THist1D* hist, 
+                    std::function<bool()> eval_lambda, 
+                    std::string var_name);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a named fill variable
+     * @see Histflow::bookHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param var_name name of fill variable
+     * @return none
+     */
+    template<typename THist1D>
+    void bookHist1D(Cut* target_cut, THist1D* hist, 
+                    std::function<bool()> eval_lambda, 
+                    std::string var_name);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a named fill variable
+     * @see Histflow::bookHist1D
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param var_name name of fill variable
+     * @return none
+     */
+    template<typename THist1D>
+    void bookHist1D(std::string target_cut_name, THist1D* hist, 
+                    std::string var_name);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a named fill variable
+     * @see Histflow::bookHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param var_name name of fill variable
+     * @return none
+     */
+    template<typename THist1D>
+    void bookHist1D(Cut* target_cut, THist1D* hist, 
+                    std::string var_name);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values 
+     * (e.g. the pt of every jet) in a single TH1::FillN call per event
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @param weight_lambda lambda function that computes the weight of each value (applied on 
+     *                      top of the event weight); must return as many weights as values
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(std::string target_cut_name, THist1D* hist, std::function<bool()> eval_lambda, 
+                       std::function<std::vector<double>()> fill_lambda,
+                       std::function<std::vector<double>()> weight_lambda);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values
+     * @see Histflow::bookVecHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @param weight_lambda lambda function that computes the weight of each value
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(Cut* target_cut, THist1D* hist, std::function<bool()> eval_lambda, 
+                       std::function<std::vector<double>()> fill_lambda,
+                       std::function<std::vector<double>()> weight_lambda);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values
+     * @see Histflow::bookVecHist1D
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @param weight_lambda lambda function that computes the weight of each value
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(std::string target_cut_name, THist1D* hist, 
+                       std::function<std::vector<double>()> fill_lambda,
+                       std::function<std::vector<double>()> weight_lambda);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values
+     * @see Histflow::bookVecHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @param weight_lambda lambda function that computes the weight of each value
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(Cut* target_cut, THist1D* hist, std::function<std::vector<double>()> fill_lambda,
+                       std::function<std::vector<double>()> weight_lambda);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values
+     * @see Histflow::bookVecHist1D
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(std::string target_cut_name, THist1D* hist, std::function<bool()> eval_lambda, 
+                       std::function<std::vector<double>()> fill_lambda);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values
+     * @see Histflow::bookVecHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(Cut* target_cut, THist1D* hist, std::function<bool()> eval_lambda, 
+                       std::function<std::vector<double>()> fill_lambda);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values
+     * @see Histflow::bookVecHist1D
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(std::string target_cut_name, THist1D* hist, 
+                       std::function<std::vector<double>()> fill_lambda);
+
+    /**
+     * Schedule a ROOT 1D histogram for a given cut that is filled with a collection of values
+     * @see Histflow::bookVecHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookVecHist1D(Cut* target_cut, THist1D* hist, std::function<std::vector<double>()> fill_lambda);
+
     /**
      * Schedule a ROOT 2D histogram for a given cut
      * @param target_cut_name target node name
@@ -149,6 +431,62 @@ public:
     template<typename THist2D>
     void bookHist2D(Cut* target_cut, THist2D* hist, std::function<std::pair<double, double>()> fill_lambda);
 
+    /**
+     * Schedule a ROOT 2D histogram for a given cut that is filled with named fill variables
+     * (see Histflow::defineFillVar)
+     * @param target_cut_name target node name
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @return none
+     */
+    template<typename THist2D>
+    void bookHist2D(std::string target_cut_name, THist2D* hist, 
+                    std::function<bool()> eval_lambda, 
+                    std::string x_var_name, std::string y_var_name);
+
+    /**
+     * Schedule a ROOT 2D histogram for a given cut that is filled with named fill variables
+     * @see Histflow::bookHist2D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @return none
+     */
+    template<typename THist2D>
+    void bookHist2D(Cut* target_cut, THist2D* hist, 
+                    std::function<bool()> eval_lambda, 
+                    std::string x_var_name, std::string y_var_name);
+
+    /**
+     * Schedule a ROOT 2D histogram for a given cut that is filled with named fill variables
+     * @see Histflow::bookHist2D
+     * @param target_cut_name target node name
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @return none
+     */
+    template<typename THist2D>
+    void bookHist2D(std::string target_cut_name, THist2D* hist, 
+                    std::string x_var_name, std::string y_var_name);
+
+    /**
+     * Schedule a ROOT 2D histogram for a given cut that is filled with named fill variables
+     * @see Histflow::bookHist2D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @return none
+     */
+    template<typename THist2D>
+    void bookHist2D(Cut* target_cut, THist2D* hist, 
+                    std::string x_var_name, std::string y_var_name);
+
     /**
      * Schedule a ROOT 3D histogram for a given cut
      * @param target_cut_name target node name
@@ -197,12 +535,333 @@ public:
     void bookHist3D(Cut* target_cut, THist3D* hist, 
                     std::function<std::tuple<double, double, double>()> fill_lambda);
 
+    /**
+     * Schedule a ROOT 3D histogram for a given cut that is filled with named fill variables
+     * (see Histflow::defineFillVar)
+     * @param target_cut_name target node name
+     * @param hist pointer to 3D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @param z_var_name name of fill variable for the z axis
+     * @return none
+     */
+    template<typename THist3D>
+    void bookHist3D(std::string target_cut_name, THist3D* hist, 
+                    std::function<bool()> eval_lambda, 
+                    std::string x_var_name, std::string y_var_name, std::string z_var_name);
+
+    /**
+     * Schedule a ROOT 3D histogram for a given cut that is filled with named fill variables
+     * @see Histflow::bookHist3D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 3D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @param z_var_name name of fill variable for the z axis
+     * @return none
+     */
+    template<typename THist3D>
+    void bookHist3D(Cut* target_cut, THist3D* hist, 
+                    std::function<bool()> eval_lambda, 
+                    std::string x_var_name, std::string y_var_name, std::string z_var_name);
+
+    /**
+     * Schedule a ROOT 3D histogram for a given cut that is filled with named fill variables
+     * @see Histflow::bookHist3D
+     * @param target_cut_name target node name
+     * @param hist pointer to 3D ROOT histogram to schedule
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @param z_var_name name of fill variable for the z axis
+     * @return none
+     */
+    template<typename THist3D>
+    void bookHist3D(std::string target_cut_name, THist3D* hist, 
+                    std::string x_var_name, std::string y_var_name, std::string z_var_name);
+
+    /**
+     * Schedule a ROOT 3D histogram for a given cut that is filled with named fill variables
+     * @see Histflow::bookHist3D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 3D ROOT histogram to schedule
+     * @param x_var_name name of fill variable for the x axis
+     * @param y_var_name name of fill variable for the y axis
+     * @param z_var_name name of fill variable for the z axis
+     * @return none
+     */
+    template<typename THist3D>
+    void bookHist3D(Cut* target_cut, THist3D* hist, 
+                    std::string x_var_name, std::string y_var_name, std::string z_var_name);
+
+    /**
+     * Schedule a uniformly binned ROOT 1D histogram for a given cut that is filled through a
+     * FastHist in the event loop; its contents are only added to the ROOT histogram when the
+     * histograms are written or merged
+     * @see Histflow::bookHist1D
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the value used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookFastHist1D(std::string target_cut_name, THist1D* hist, std::function<bool()> eval_lambda, 
+                        std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a uniformly binned ROOT 1D histogram for a given cut that is filled through a
+     * FastHist in the event loop
+     * @see Histflow::bookFastHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the value used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookFastHist1D(Cut* target_cut, THist1D* hist, std::function<bool()> eval_lambda, 
+                        std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a uniformly binned ROOT 1D histogram for a given cut that is filled through a
+     * FastHist in the event loop
+     * @see Histflow::bookFastHist1D
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the value used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookFastHist1D(std::string target_cut_name, THist1D* hist, std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a uniformly binned ROOT 1D histogram for a given cut that is filled through a
+     * FastHist in the event loop
+     * @see Histflow::bookFastHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the value used to fill the histogram
+     * @return none
+     */
+    template<typename THist1D>
+    void bookFastHist1D(Cut* target_cut, THist1D* hist, std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a uniformly binned ROOT 2D histogram for a given cut that is filled through a
+     * FastHist in the event loop; its contents are only added to the ROOT histogram when the
+     * histograms are written or merged
+     * @see Histflow::bookHist2D
+     * @param target_cut_name target node name
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist2D>
+    void bookFastHist2D(std::string target_cut_name, THist2D* hist, 
+                        std::function<bool()> eval_lambda, 
+                        std::function<std::pair<double, double>()> fill_lambda);
+
+    /**
+     * Schedule a uniformly binned ROOT 2D histogram for a given cut that is filled through a
+     * FastHist in the event loop
+     * @see Histflow::bookFastHist2D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histogram should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist2D>
+    void bookFastHist2D(Cut* target_cut, THist2D* hist, 
+                        std::function<bool()> eval_lambda, 
+                        std::function<std::pair<double, double>()> fill_lambda);
+
+    /**
+     * Schedule a uniformly binned ROOT 2D histogram for a given cut that is filled through a
+     * FastHist in the event loop
+     * @see Histflow::bookFastHist2D
+     * @param target_cut_name target node name
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist2D>
+    void bookFastHist2D(std::string target_cut_name, THist2D* hist, 
+                        std::function<std::pair<double, double>()> fill_lambda);
+
+    /**
+     * Schedule a uniformly binned ROOT 2D histogram for a given cut that is filled through a
+     * FastHist in the event loop
+     * @see Histflow::bookFastHist2D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histogram
+     * @return none
+     */
+    template<typename THist2D>
+    void bookFastHist2D(Cut* target_cut, THist2D* hist, 
+                        std::function<std::pair<double, double>()> fill_lambda);
+
+    /**
+     * Set alternative event weights; the number of weights cannot be changed once any 
+     * histograms have been booked with Histflow::bookMultiWeightHist1D or 
+     * Histflow::bookMultiWeightHist2D
+     * @see Cutflow::setMultiWeights
+     * @param new_n_multi_weights number of alternative weights
+     * @param new_multi_weights_lambda lambda function that computes the alternative weights
+     * @return none
+     */
+    void setMultiWeights(unsigned int new_n_multi_weights, 
+                         std::function<std::vector<double>()> new_multi_weights_lambda) override;
+
+    /**
+     * Schedule a set of ROOT 1D histograms for a given cut, one for each alternative weight 
+     * (see Cutflow::setMultiWeights), that are filled together
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histograms should be filled
+     * @param fill_lambda lambda function that computes the value used to fill the histograms
+     * @return none
+     */
+    template<typename THist1D>
+    void bookMultiWeightHist1D(std::string target_cut_name, THist1D* hist, std::function<bool()> eval_lambda, 
+                               std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a set of ROOT 1D histograms for a given cut, one for each alternative weight
+     * @see Histflow::bookMultiWeightHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histograms should be filled
+     * @param fill_lambda lambda function that computes the value used to fill the histograms
+     * @return none
+     */
+    template<typename THist1D>
+    void bookMultiWeightHist1D(Cut* target_cut, THist1D* hist, std::function<bool()> eval_lambda, 
+                               std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a set of ROOT 1D histograms for a given cut, one for each alternative weight
+     * @see Histflow::bookMultiWeightHist1D
+     * @param target_cut_name target node name
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the value used to fill the histograms
+     * @return none
+     */
+    template<typename THist1D>
+    void bookMultiWeightHist1D(std::string target_cut_name, THist1D* hist, 
+                               std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a set of ROOT 1D histograms for a given cut, one for each alternative weight
+     * @see Histflow::bookMultiWeightHist1D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 1D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the value used to fill the histograms
+     * @return none
+     */
+    template<typename THist1D>
+    void bookMultiWeightHist1D(Cut* target_cut, THist1D* hist, 
+                               std::function<double()> fill_lambda);
+
+    /**
+     * Schedule a set of ROOT 2D histograms for a given cut, one for each alternative weight 
+     * (see Cutflow::setMultiWeights), that are filled together
+     * @param target_cut_name target node name
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histograms should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histograms
+     * @return none
+     */
+    template<typename THist2D>
+    void bookMultiWeightHist2D(std::string target_cut_name, THist2D* hist, 
+                               std::function<bool()> eval_lambda, 
+                               std::function<std::pair<double, double>()> fill_lambda);
+
+    /**
+     * Schedule a set of ROOT 2D histograms for a given cut, one for each alternative weight
+     * @see Histflow::bookMultiWeightHist2D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param eval_lambda lambda function that computes whether histograms should be filled
+     * @param fill_lambda lambda function that computes the values used to fill the histograms
+     * @return none
+     */
+    template<typename THist2D>
+    void bookMultiWeightHist2D(Cut* target_cut, THist2D* hist, 
+                               std::function<bool()> eval_lambda, 
+                               std::function<std::pair<double, double>()> fill_lambda);
+
+    /**
+     * Schedule a set of ROOT 2D histograms for a given cut, one for each alternative weight
+     * @see Histflow::bookMultiWeightHist2D
+     * @param target_cut_name target node name
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histograms
+     * @return none
+     */
+    template<typename THist2D>
+    void bookMultiWeightHist2D(std::string target_cut_name, THist2D* hist, 
+                               std::function<std::pair<double, double>()> fill_lambda);
+
+    /**
+     * Schedule a set of ROOT 2D histograms for a given cut, one for each alternative weight
+     * @see Histflow::bookMultiWeightHist2D
+     * @param target_cut pointer to target node
+     * @param hist pointer to 2D ROOT histogram to schedule
+     * @param fill_lambda lambda function that computes the values used to fill the histograms
+     * @return none
+     */
+    template<typename THist2D>
+    void bookMultiWeightHist2D(Cut* target_cut, THist2D* hist, 
+                               std::function<std::pair<double, double>()> fill_lambda);
+
     /**
      * Write all histograms to a given TFile
      * @param tfile pointer to ROOT TFile to write histograms to
      * @return none
      */
     void writeHists(TFile* tfile);
+
+    /**
+     * Periodically write a snapshot of the cutflow to {output_dir}/{name}_snapshot.csv and 
+     * of every filled histogram to {output_dir}/{name}_snapshot.root while running
+     * @see Cutflow::setSnapshot
+     * @param output_dir target directory for snapshots
+     * @param n_events number of events between snapshots (zero to only use seconds)
+     * @param seconds number of seconds between snapshots (optional; zero to only use n_events)
+     * @return none
+     */
+    void setSnapshot(std::string output_dir, unsigned int n_events, double seconds = 0.) override;
+
+    using Cutflow::merge;
+
+    /**
+     * Add the cut counts, runtimes, and histograms of another histflow with the same cuts 
+     * and bookings to this one. 
+     *
+     * This is how Histflow is run in a multi-threaded loop: each thread fills its own 
+     * histflow (i.e. its own copy of every histogram), and the copies are merged once the 
+     * threads have joined, so no atomics or locks are needed while filling. A periodic 
+     * reduction can be done by merging with reset = true while the other thread is paused.
+     * @code{.cpp}
+     * std::vector<Histflow*> histflows; // one per thread, built by the same function
+     * // ...run threads...
+     * for (unsigned int i = 1; i < histflows.size(); ++i) 
+     * { 
+     *     histflows.at(0)->merge(*histflows.at(i)); 
+     * }
+     * histflows.at(0)->writeHists(tfile);
+     * @endcode
+     * @param other histflow to merge into this one
+     * @param reset reset the counts, runtimes, and histograms of the other histflow after 
+     *              merging (optional)
+     * @return none
+     */
+    void merge(Histflow& other, bool reset = false);
 };
 
 #include "histflow.icc"
@@ -10,6 +10,8 @@
 #include "TTreeCache.h"
 #include "TTreeCacheUnzip.h"
 
+#include "utilities.h"
+
 /**
  * Object to handle looping over ROOT files
  */
@@ -18,6 +20,8 @@ class Looper
 protected:
     /** Flag for continuing event loop */
     bool keep_alive;
+    /** Names of friend TTrees and the directories of their files */
+    std::vector<std::pair<TString, std::string>> friends;
 public:
     /** ROOT TChain of files to loop over */
     TChain* tchain;
@@ -76,6 +80,28 @@ public:
      */
     void run(std::function<void(TTree* ttree)> init, std::function<void(int entry)> eval);
 
+    /**
+     * Run looper with file- and event-processing logic captured in void lambda functions, 
+     * plus file-level steps that run after the event loop of each file, while the file is 
+     * still open (e.g. Arbusto::finish)
+     * @see Looper::run
+     * @param init file-level initialization steps captured in a void lambda function
+     * @param eval event-level logic captured in a void lambda function
+     * @param finish file-level steps after the event loop captured in a void lambda function
+     * @return none
+     */
+    void run(std::function<void(TTree* ttree)> init, std::function<void(int entry)> eval, 
+             std::function<void(TTree* ttree)> finish);
+
+    /**
+     * Attach the friend tree that Arbol::setFriendOutput wrote for each input file, such 
+     * that its branches can be read from the TTree passed to the file-level lambda
+     * @param friend_ttree_name name of friend TTree (e.g. 'Friends')
+     * @param friend_dir directory of friend tree files
+     * @return none
+     */
+    void addFriend(TString friend_ttree_name, std::string friend_dir);
+
     /**
      * Stop event loop
      * @return none
@@ -0,0 +1,112 @@
+#ifndef MULTIWEIGHTHIST_H
+#define MULTIWEIGHTHIST_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TH1.h"
+#include "TString.h"
+
+/**
+ * Set of 1D or 2D histograms with identical binning that are filled with the same values
+ * but a different event weight each (e.g. PDF and scale variations).
+ *
+ * The bin is found once per fill, and the weighted contents are kept in a single contiguous
+ * array with all weights of a given bin next to each other, such that a fill is one loop 
+ * over the weights. A separate ROOT histogram for each weight is only made when the set is 
+ * written (named {name}__w{index}).
+ */
+class MultiWeightHist
+{
+protected:
+    /** Pointer to ROOT histogram that defines the binning and name of every histogram */
+    TH1* target;
+    /** Number of weights */
+    unsigned int n_weights;
+    /** Sum of weights (index = global bin*n_weights + weight index) */
+    std::vector<double> sumw;
+    /** Sum of squared weights (index = global bin*n_weights + weight index) */
+    std::vector<double> sumw2;
+    /** Number of fills */
+    double n_entries;
+
+    /**
+     * (PROTECTED) Add weights to a given bin
+     * @param bin global bin number
+     * @param weight common weight (e.g. the cut weight)
+     * @param weights one weight per histogram
+     * @return none
+     */
+    void fillBin(int bin, double weight, const double* weights);
+
+public:
+    /**
+     * MultiWeightHist object constructor
+     * @param new_target pointer to 1D or 2D ROOT histogram (ownership is taken)
+     * @param new_n_weights number of weights
+     * @return none
+     */
+    MultiWeightHist(TH1* new_target, unsigned int new_n_weights);
+
+    /**
+     * MultiWeightHist object destructor
+     * @return none
+     */
+    virtual ~MultiWeightHist();
+
+    /**
+     * Fill 1D histograms
+     * @param x value
+     * @param weight common weight
+     * @param weights one weight per histogram
+     * @return none
+     */
+    void fill(double x, double weight, const double* weights);
+
+    /**
+     * Fill 2D histograms
+     * @param x value along x axis
+     * @param y value along y axis
+     * @param weight common weight
+     * @param weights one weight per histogram
+     * @return none
+     */
+    void fill(double x, double y, double weight, const double* weights);
+
+    /**
+     * Create a copy of this set of histograms (including its contents)
+     * @return pointer to new set of histograms
+     */
+    MultiWeightHist* clone();
+
+    /**
+     * Add the contents of another set of histograms with the same binning and weights
+     * @param other set of histograms to add
+     * @return none
+     */
+    void add(MultiWeightHist& other);
+
+    /**
+     * Reset the contents of every histogram
+     * @return none
+     */
+    void reset();
+
+    /**
+     * Write one ROOT histogram per weight to the current directory
+     * @return none
+     */
+    void write();
+
+    /**
+     * Get number of weights
+     * @return number of weights
+     */
+    unsigned int size();
+};
+
+#include "multiweighthist.icc"
+
+#endif
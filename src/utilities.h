@@ -8,6 +8,11 @@
 #include <string>
 #include <map>
 #include <cmath>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
 
 namespace Utilities 
 {
@@ -42,6 +47,19 @@ namespace Utilities
          * @return none
          */
         RunningStat();
+        /**
+         * RunningStat object constructor from previously computed statistics (e.g. read back 
+         * from a file), such that it can be merged with other RunningStat objects
+         * @param new_n_values number of values pushed
+         * @param new_sum sum of values pushed
+         * @param new_max max of values pushed
+         * @param new_min min of values pushed
+         * @param new_mean mean of values pushed
+         * @param new_variance variance of values pushed
+         * @return none
+         */
+        RunningStat(int new_n_values, float new_sum, float new_max, float new_min, 
+                    float new_mean, float new_variance);
         /**
          * Push a new value and update running statistics
          * @param value new value to push
@@ -83,6 +101,14 @@ namespace Utilities
          * @return approximate standard deviation of values pushed
          */
         float stddev();
+        /**
+         * Combine the values pushed to another RunningStat object with this one
+         *
+         * Uses the pairwise update from Chan, Golub, and LeVeque (1979)
+         * @param other RunningStat object to merge into this one
+         * @return none
+         */
+        void merge(RunningStat& other);
     };
 
     /**
@@ -137,6 +163,254 @@ namespace Utilities
     };
     typedef std::vector<CSVFile> CSVFiles;
 
+    /**
+     * Text files that are built in memory and then each written to disk with a single write, 
+     * rather than opening the file again for every line
+     */
+    class ReportFiles
+    {
+    protected:
+        /** Name (e.g. output.csv) of each file */
+        std::vector<std::string> names;
+        /** Contents of each file */
+        std::vector<std::string> contents;
+    public:
+        /**
+         * ReportFiles object constructor
+         * @return none
+         */
+        ReportFiles();
+        /**
+         * ReportFiles object destructor
+         * @return none
+         */
+        virtual ~ReportFiles();
+        /**
+         * Add a new file
+         * @param new_name name of new file (e.g. output.csv)
+         * @param new_contents initial contents of new file (default: empty)
+         * @return index of new file
+         */
+        unsigned int add(std::string new_name, std::string new_contents = "");
+        /**
+         * Get the contents of a file, which can be appended to in place
+         * @param file_i index of file
+         * @return reference to contents of file
+         */
+        std::string& at(unsigned int file_i);
+        /**
+         * Write every file to disk
+         * @return none
+         */
+        void write();
+    };
+
+    /**
+     * Fixed-size ring buffer that overwrites its oldest record once full; meant to be owned 
+     * by a single thread (e.g. declared thread_local), so pushing requires no locks
+     * @tparam Type type of records (should be trivially copyable)
+     * @tparam Size maximum number of records kept
+     */
+    template<typename Type, unsigned int Size>
+    class RingBuffer
+    {
+    protected:
+        /** Storage for records */
+        Type records[Size];
+        /** Total number of records pushed */
+        unsigned long n_pushed;
+    public:
+        /**
+         * RingBuffer object constructor
+         * @return none
+         */
+        RingBuffer();
+        /**
+         * Push a new record, overwriting the oldest record if the buffer is full
+         * @param record new record
+         * @return none
+         */
+        void push(const Type& record);
+        /**
+         * Get number of records currently held
+         * @return number of records held (at most Size)
+         */
+        unsigned int size();
+        /**
+         * Get a record held in the buffer
+         * @param index index of record (0 is the oldest record held)
+         * @return reference to record
+         */
+        Type& at(unsigned int index);
+        /**
+         * Drop all records
+         * @return none
+         */
+        void clear();
+    };
+
+    /**
+     * Copy a reset value into a value
+     * @tparam Type type of value
+     * @param value value to reset
+     * @param reset_value reset value
+     * @return none
+     */
+    template<typename Type>
+    void resetInPlace(Type& value, const Type& reset_value);
+
+    /**
+     * Copy a reset vector into a vector without giving up its capacity, such that refilling
+     * it after a reset does not allocate
+     * @tparam Type type of vector elements
+     * @param value vector to reset
+     * @param reset_value reset vector
+     * @return none
+     */
+    template<typename Type>
+    void resetInPlace(std::vector<Type>& value, const std::vector<Type>& reset_value);
+
+    /**
+     * Get the name of the friend tree file that is written for a given input file (see 
+     * Arbol::setFriendOutput and Looper::addFriend)
+     * @param friend_dir directory of friend tree files
+     * @param input_file_name name of input file
+     * @return {friend_dir}/{input file name without '.root'}_friend.root
+     */
+    std::string getFriendFileName(std::string friend_dir, std::string input_file_name);
+
+    /**
+     * Append the raw bytes of a trivially copyable value to a buffer
+     * @tparam Type type of value
+     * @param buffer buffer to append to
+     * @param value value to append
+     * @return none
+     */
+    template<typename Type>
+    void packValue(std::string& buffer, Type value);
+
+    /**
+     * Read a trivially copyable value from the raw bytes of a buffer (see packValue)
+     * @tparam Type type of value
+     * @param buffer buffer to read from
+     * @param offset position of value in buffer; moved past the value
+     * @return value
+     */
+    template<typename Type>
+    Type unpackValue(const std::string& buffer, size_t& offset);
+
+    /**
+     * Storage for values that are all reset to their respective reset values at once (e.g. 
+     * before every event).
+     *
+     * Trivially copyable values (int, float, etc.) are packed into fixed-size chunks that are
+     * never moved, each of which has a matching chunk of reset values with the same layout, 
+     * so a reset is a single memcpy per chunk. Any other values (e.g. std::vector) are kept 
+     * in a dense list and reset with Utilities::resetInPlace, so vectors keep their capacity.
+     */
+    class ResetArena
+    {
+    protected:
+        /** Minimum size of each chunk in bytes */
+        unsigned int chunk_size;
+        /** Chunks of trivially copyable values */
+        std::vector<std::shared_ptr<char>> value_chunks;
+        /** Chunks of reset values (same layout as ResetArena::value_chunks) */
+        std::vector<std::shared_ptr<char>> reset_chunks;
+        /** Size of each chunk in bytes */
+        std::vector<unsigned int> chunk_capacities;
+        /** Number of bytes used in each chunk */
+        std::vector<unsigned int> chunk_sizes;
+        /** Values and reset values that are not trivially copyable (value, reset value, ...) */
+        std::vector<std::shared_ptr<void>> objects;
+        /** Functions that assign one value that is not trivially copyable to another */
+        std::vector<std::function<void(void*, const void*)>> object_assigners;
+        /** Functions that copy a value that is not trivially copyable */
+        std::vector<std::function<std::shared_ptr<void>(const void*)>> object_copiers;
+        /**
+         * (PROTECTED) Allocate a trivially copyable value and reset value in the chunks
+         * @tparam Type type of value
+         * @param value pointer to set to the new value
+         * @param reset_value pointer to set to the new reset value
+         * @return none
+         */
+        template<typename Type>
+        void allocate(Type*& value, Type*& reset_value, std::true_type);
+        /**
+         * (PROTECTED) Allocate a value and reset value that are not trivially copyable
+         * @tparam Type type of value
+         * @param value pointer to set to the new value
+         * @param reset_value pointer to set to the new reset value
+         * @return none
+         */
+        template<typename Type>
+        void allocate(Type*& value, Type*& reset_value, std::false_type);
+        /**
+         * (PROTECTED) Find the value in a mirror that corresponds to a trivially copyable value
+         * @tparam Type type of value
+         * @param value pointer to value in this arena
+         * @param mirror arena made by ResetArena::mirror
+         * @return pointer to value in mirror
+         */
+        template<typename Type>
+        Type* translate(Type* value, ResetArena& mirror, std::true_type);
+        /**
+         * (PROTECTED) Find the value in a mirror that corresponds to a value that is not 
+         * trivially copyable
+         * @tparam Type type of value
+         * @param value pointer to value in this arena
+         * @param mirror arena made by ResetArena::mirror
+         * @return pointer to value in mirror
+         */
+        template<typename Type>
+        Type* translate(Type* value, ResetArena& mirror, std::false_type);
+    public:
+        /**
+         * ResetArena object constructor
+         * @param new_chunk_size minimum size of each chunk in bytes (optional)
+         * @return none
+         */
+        ResetArena(unsigned int new_chunk_size = 4096);
+        /**
+         * Allocate a new value and reset value (both value-initialized), which stay at the 
+         * same address for as long as the arena (or any copy of it) exists
+         * @tparam Type type of value
+         * @param value pointer to set to the new value
+         * @param reset_value pointer to set to the new reset value
+         * @return none
+         */
+        template<typename Type>
+        void allocate(Type*& value, Type*& reset_value);
+        /**
+         * Set every value to its reset value
+         * @return none
+         */
+        void reset();
+        /**
+         * Create an independent arena with the same layout and a copy of every value (reset 
+         * values are shared); values must not be allocated in either arena afterwards
+         * @return new arena
+         */
+        ResetArena mirror();
+        /**
+         * Copy every value into an arena made by ResetArena::mirror (vectors in the target 
+         * keep their capacity)
+         * @param target arena to copy values to
+         * @return none
+         */
+        void copyValues(ResetArena& target);
+        /**
+         * Find the value in an arena made by ResetArena::mirror that corresponds to a value
+         * in this arena
+         * @tparam Type type of value
+         * @param value pointer to value in this arena
+         * @param mirror arena made by ResetArena::mirror
+         * @return pointer to value in mirror
+         */
+        template<typename Type>
+        Type* translate(Type* value, ResetArena& mirror);
+    };
+
     /**
      * "Dynamic" object that serves as a base for templated objects
      */
@@ -158,10 +432,12 @@ namespace Utilities
     class Variable : public Dynamic
     {
     protected:
-        /** Variable value */
-        Type value;
-        /** Variable reset value */
-        Type reset_value;
+        /** Pointer to variable value */
+        Type* value;
+        /** Pointer to variable reset value */
+        Type* reset_value;
+        /** Flag indicating that the value and reset value are owned by this object */
+        bool owns_values;
     public:
         /**
          * Variable object default constructor
@@ -174,6 +450,14 @@ namespace Utilities
          * @return none
          */
         Variable(Type new_reset_value);
+        /**
+         * Variable object overload constructor for a value held elsewhere (e.g. in a 
+         * Utilities::ResetArena)
+         * @param new_value pointer to value
+         * @param new_reset_value pointer to reset value
+         * @return none
+         */
+        Variable(Type* new_value, Type* new_reset_value);
         /**
          * Variable object destructor
          * @return none
@@ -209,6 +493,33 @@ namespace Utilities
         void resetValue();
     };
 
+    /**
+     * Typed handle to a variable in a Utilities::Variables object; the type is checked once, 
+     * when the key is made, and each lookup by key is an index into contiguous storage
+     * @tparam Type type of variable
+     */
+    template<typename Type>
+    class Key
+    {
+    public:
+        /** Index of variable in Utilities::Variables */
+        unsigned int index;
+        /** Index of a key that does not refer to any variable */
+        static const unsigned int no_index = ~0u;
+        /**
+         * Key object constructor (does not refer to any variable until assigned, and is 
+         * rejected by Utilities::Variables until then)
+         * @return none
+         */
+        Key();
+        /**
+         * Key object overload constructor
+         * @param new_index index of variable in Utilities::Variables
+         * @return none
+         */
+        explicit Key(unsigned int new_index);
+    };
+
     /**
      * A group of "dynamic" variables
      */
@@ -217,8 +528,12 @@ namespace Utilities
     protected:
         /** Map of Utilities::Variable objects */
         std::map<std::string, Dynamic*> variables;
-        /** Map of Utilities::Variable::resetValue functions captured in lambdas*/
-        std::map<std::string, std::function<void()>> resetters;
+        /** Storage for the value and reset value of every variable */
+        ResetArena arena;
+        /** Pointer to the value of every variable, indexed by Utilities::Key::index */
+        std::vector<void*> slots;
+        /** Map of variable names to their index in Variables::slots */
+        std::map<std::string, unsigned int> slot_indices;
         /**
          * (PROTECTED) Retrieve variable object from map if it exists
          * @tparam Type type of variable
@@ -227,6 +542,15 @@ namespace Utilities
          */
         template<typename Type>
         Variable<Type>* getVar(std::string name);
+        /**
+         * (PROTECTED) Throw an exception if a key does not refer to a variable in this object
+         * @tparam Type type of variable
+         * @param key key to check
+         * @param caller name of calling method (e.g. 'Utilities::Variables::getVal')
+         * @return none
+         */
+        template<typename Type>
+        void checkKey(Key<Type> key, std::string caller);
     public:
         /**
          * Variables object constructor
@@ -239,22 +563,56 @@ namespace Utilities
          */
         virtual ~Variables();
         /**
-         * Add blank variable to map
+         * Add blank variable to map (an exception is thrown if the name is already used)
          * @tparam Type type of new variable
          * @param new_name name of new variable
-         * @return none
+         * @return key to new variable
          */
         template<typename Type>
-        void newVar(std::string new_name);
+        Key<Type> newVar(std::string new_name);
         /**
          * Add new variable to map with reset value
          * @tparam Type type of variable
          * @param new_name name of variable
          * @param new_reset_value reset value of new variable
+         * @return key to new variable
+         */
+        template<typename Type>
+        Key<Type> newVar(std::string new_name, Type new_reset_value);
+        /**
+         * Get key to a variable in map if it exists and has the given type; keys should be 
+         * made once (e.g. outside of the event loop) and used for every lookup thereafter
+         * @tparam Type type of variable
+         * @param name name of variable
+         * @return key to variable
+         */
+        template<typename Type>
+        Key<Type> getKey(std::string name);
+        /**
+         * Get variable value by key
+         * @tparam Type type of variable
+         * @param key key from this object
+         * @return value of variable
+         */
+        template<typename Type>
+        Type getVal(Key<Type> key);
+        /**
+         * Get variable value by key by reference
+         * @tparam Type type of variable
+         * @param key key from this object
+         * @return reference to value of variable
+         */
+        template<typename Type>
+        Type& getRef(Key<Type> key);
+        /**
+         * Set value of a variable by key
+         * @tparam Type type of variable
+         * @param key key from this object
+         * @param new_value new value for variable
          * @return none
          */
         template<typename Type>
-        void newVar(std::string new_name, Type new_reset_value);
+        void setVal(Key<Type> key, Type new_value);
         /**
          * Get variable value in map if it exists
          * @tparam Type type of variable
@@ -291,11 +649,10 @@ namespace Utilities
         /**
          * Set value of each variable in map to its respective reset value.
          *
-         * Uses a map of "resetters" because Utilities::Variable<Type>::resetValue() 
-         * cannot be called across an arbitrary number of such objects, due to the 
-         * fact that the value of Type for each object would need to be supplied. The 
-         * "resetters" circumvent this issue by capturing the function call in a 
-         * lambda function for later use.
+         * Every value is held in a Utilities::ResetArena, because 
+         * Utilities::Variable<Type>::resetValue() cannot be called across an arbitrary number 
+         * of such objects, due to the fact that the value of Type for each object would need 
+         * to be supplied.
          * @return none
          */
         void resetVars();